@@ -0,0 +1,169 @@
+/*******************************************************************************
+ * @file		bench.h
+ * @brief		Cost of a statement in each DEBUG case, at 1, 4 and N threads
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_BENCH_H
+#define DEBUG_BENCH_H
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_THREADS 64
+
+/**
+ * @brief Loop of a benchmark: calls of one trace statement
+ */
+typedef void (*bench_body)(long calls);
+
+/**
+ * @brief Value of DEBUG, and calls per thread
+ * @details The same trace statement is off, filtered by level, filtered by
+ * name, then emitted.
+ */
+struct bench_case
+{
+	const char *name;
+	const char *debug; // NULL to unset
+	long calls;
+};
+
+static const struct bench_case bench_cases[] = {
+	{"DEBUG unset", NULL, 20000000},
+	{"filtered by level", "2", 20000000},
+	{"filtered by name", "6:nothing*", 20000000},
+	{"emitted to /dev/null", "6", 200000},
+};
+
+struct bench_thread
+{
+	pthread_t thread;
+	bench_body body;
+	long calls;
+	pthread_barrier_t *start;
+};
+
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void *bench_thread_main(void *arg)
+{
+	struct bench_thread *t = (struct bench_thread *)arg;
+
+	pthread_barrier_wait(t->start);
+	t->body(t->calls);
+	return NULL;
+}
+
+/**
+ * @brief One case at one thread count, in a child so that DEBUG is read anew
+ * @return ns per call seen from each thread (wall time / calls per thread)
+ */
+static double bench_case_run(bench_body body, const struct bench_case *c, int threads)
+{
+	int fds[2];
+	double ns = -1;
+	pid_t pid;
+
+	if (pipe(fds) != 0)
+		return -1;
+	pid = fork();
+	if (pid == 0)
+	{
+		struct bench_thread workers[BENCH_THREADS];
+		pthread_barrier_t start;
+		int null = open("/dev/null", O_WRONLY);
+
+		if (c->debug != NULL)
+			setenv("DEBUG", c->debug, 1);
+		else
+			unsetenv("DEBUG");
+		dup2(null, STDOUT_FILENO);
+		dup2(null, STDERR_FILENO);
+		pthread_barrier_init(&start, NULL, threads + 1);
+		for (int i = 0; i < threads; ++i)
+		{
+			workers[i].body = body;
+			workers[i].calls = c->calls;
+			workers[i].start = &start;
+			pthread_create(&workers[i].thread, NULL, bench_thread_main, &workers[i]);
+		}
+		ns = bench_now();
+		pthread_barrier_wait(&start);
+		for (int i = 0; i < threads; ++i)
+			pthread_join(workers[i].thread, NULL);
+		fflush(NULL);
+		ns = (bench_now() - ns) / c->calls;
+		if (write(fds[1], &ns, sizeof(ns)) != sizeof(ns))
+			_exit(1);
+		_exit(0);
+	}
+	close(fds[1]);
+	if (pid < 0 || read(fds[0], &ns, sizeof(ns)) != sizeof(ns))
+		ns = -1;
+	close(fds[0]);
+	if (pid > 0)
+		waitpid(pid, NULL, 0);
+	return ns;
+}
+
+/**
+ * @brief Every case at 1, 4 and N (CPUs online) threads
+ */
+__attribute__((unused)) static void bench_run(const char *api, bench_body body)
+{
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	int threads[3] = {1, 4, (int)(online < 1 ? 1 : online > BENCH_THREADS ? BENCH_THREADS : online)};
+	char n[16];
+
+	snprintf(n, sizeof(n), "N = %d", threads[2]);
+	printf("%-4s %-22s %12s %12s %12s   (ns/call)\n", api, "", "1 thread", "4 threads", n);
+	for (size_t i = 0; i < sizeof(bench_cases) / sizeof(*bench_cases); ++i)
+	{
+		printf("%-4s %-22s", api, bench_cases[i].name);
+		for (int t = 0; t < 3; ++t)
+			printf(" %12.2f", bench_case_run(body, &bench_cases[i], threads[t]));
+		printf("\n");
+		fflush(stdout);
+	}
+}
+
+/**
+ * @brief The emitted case in each DEBUG_FORMAT, at 1 thread
+ */
+__attribute__((unused)) static void bench_formats(const char *api, bench_body body)
+{
+	static const char *const formats[] = {"text", "json", "logfmt"};
+	static const struct bench_case emitted = {"emitted to /dev/null", "6", 200000};
+
+	printf("%-4s %-22s %12s   (ns/record)\n", api, "DEBUG_FORMAT", "1 thread");
+	for (size_t i = 0; i < sizeof(formats) / sizeof(*formats); ++i)
+	{
+		setenv("DEBUG_FORMAT", formats[i], 1);
+		printf("%-4s %-22s %12.2f\n", api, formats[i], bench_case_run(body, &emitted, 1));
+		fflush(stdout);
+	}
+	unsetenv("DEBUG_FORMAT");
+}
+
+#endif // DEBUG_BENCH_H
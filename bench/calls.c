@@ -0,0 +1,29 @@
+/*******************************************************************************
+ * @file		calls.c
+ * @brief		Cost of a C statement: off, filtered out, emitted
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#include "../src/debug.h"
+#include "bench.h"
+
+static void body(long calls)
+{
+	for (long i = 0; i < calls; ++i)
+		printf_trace("value %ld", i);
+}
+
+int main(void)
+{
+	bench_run("C", body);
+	return 0;
+}
@@ -0,0 +1,36 @@
+/*******************************************************************************
+ * @file		calls.cpp
+ * @brief		Cost of a C++ statement: off, filtered out, emitted; streamed then formatted
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#include "../src/debug.hpp"
+#include "bench.h"
+
+static void body(long calls)
+{
+	for (long i = 0; i < calls; ++i)
+		debug::log::trace() << "value " << i;
+}
+
+static void body_format(long calls)
+{
+	for (long i = 0; i < calls; ++i)
+		debug::log::trace("value {}", i);
+}
+
+int main(void)
+{
+	bench_run("C++", body);
+	bench_run("{}", body_format);
+	return 0;
+}
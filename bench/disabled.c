@@ -0,0 +1,44 @@
+/*******************************************************************************
+ * @file		disabled.c
+ * @brief		C statements of a build without DEBUG, against none at all
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#include "../src/debug.h"
+
+#ifdef BENCH_BARE
+#define STATEMENT(...)
+#else
+#define STATEMENT(...) __VA_ARGS__
+#endif // BENCH_BARE
+
+int compute(int v)
+{
+	STATEMENT(printf_trace("compute %d", v);)
+	for (int i = 0; i < 8; ++i)
+	{
+		STATEMENT(printf_debug("step %d of %d", i, v);)
+		v = v * 31 + i;
+	}
+	STATEMENT(printf_info("result %d", v);)
+	return v;
+}
+
+int main(int argc, char **argv)
+{
+	(void)argv;
+	STATEMENT(dbg_printf("start");)
+	STATEMENT(printf_fatal("fatal %d", argc);)
+	STATEMENT(printf_error("error %d", argc);)
+	STATEMENT(printf_warning("warning %d", argc);)
+	return compute(argc) & 1;
+}
@@ -0,0 +1,52 @@
+/*******************************************************************************
+ * @file		disabled.cpp
+ * @brief		C++ statements of a build without DEBUG, against none at all
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#include "../src/debug.hpp"
+
+#ifdef BENCH_BARE
+#define STATEMENT(...)
+#else
+#define STATEMENT(...) __VA_ARGS__
+#endif // BENCH_BARE
+
+/** Costly: only called by statements which pass, never without DEBUG */
+std::string dump(int v)
+{
+	return "value " + std::to_string(v);
+}
+
+int compute(int v)
+{
+	STATEMENT(debug::log::trace() << "compute " << v;)
+	for (int i = 0; i < 8; ++i)
+	{
+		STATEMENT(debug::log::debug() << "step " << i << " of " << v;)
+		v = v * 31 + i;
+	}
+	STATEMENT(debug::log::info() << "result " << v << std::endl;)
+	STATEMENT(debug::log::debug([&] { return dump(v); });)
+	STATEMENT(debug::log::trace() << "dump " << [&] { return dump(v); };)
+	return v;
+}
+
+int main(int argc, char **)
+{
+	STATEMENT(debug::cout() << "start";)
+	STATEMENT(debug::cerr() << "stderr " << argc;)
+	STATEMENT(debug::log::fatal() << "fatal " << argc;)
+	STATEMENT(debug::log::error() << "error " << std::hex << argc;)
+	STATEMENT(debug::log::warning() << "warning " << argc;)
+	return compute(argc) & 1;
+}
@@ -0,0 +1,139 @@
+/*******************************************************************************
+ * @file		glob.c
+ * @brief		Glob matcher of DEBUG against the POSIX regex it replaced
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <regex.h>
+#include <time.h>
+
+#include "../src/glob.h"
+
+#define ITERATIONS 200000
+
+static const char *names[] = {
+	"src/net/http_server.c",
+	"src/net/http_parser.c",
+	"src/storage/page_cache.c",
+	"src/storage/wal_writer.cpp",
+	"src/core/connection_manager.cpp",
+	"tests/unit/test_scheduler.c",
+	"main",
+	"http_parse_request_line",
+	"http_server_accept",
+	"page_cache_evict_lru",
+	"wal_writer_flush_segment",
+	"ConnectionManager::on_read",
+	"ConnectionManager::close_idle",
+	"scheduler_run_once",
+	"test_scheduler_fairness",
+	"json_encode_value",
+};
+
+static const char *patterns[] = {
+	"main*",
+	"*http*",
+	"*connection*manager*",
+	"src/storage/*.c",
+	"*_test",
+	"wal_*_segment",
+	"*::on_*",
+	"*evict*lru",
+};
+
+#define COUNT(a) (sizeof(a) / sizeof(*(a)))
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief Same translation as the regex based filter did
+ */
+static void to_regex(char *regex, const char *glob)
+{
+	*regex++ = '^';
+	for (; *glob != '\0'; ++glob)
+	{
+		if (*glob == '*')
+		{
+			*regex++ = '.';
+			*regex++ = '*';
+			continue;
+		}
+		if (strchr(".[]()\\^$+?{}|", *glob) != NULL)
+			*regex++ = '\\';
+		*regex++ = *glob;
+	}
+	*regex++ = '$';
+	*regex = '\0';
+}
+
+int main(void)
+{
+	static struct debug_glob globs[COUNT(patterns)];
+	regex_t regexes[COUNT(patterns)];
+	struct debug_glob_subject subjects[COUNT(names)];
+	unsigned long hits_glob = 0;
+	unsigned long hits_regex = 0;
+	double start;
+	double glob_ns;
+	double regex_ns;
+	double matches = (double)ITERATIONS * COUNT(names) * COUNT(patterns);
+
+	for (size_t i = 0; i < COUNT(patterns); ++i)
+	{
+		char regex[1024];
+
+		debug_glob_compile(&globs[i], patterns[i]);
+		to_regex(regex, patterns[i]);
+		regcomp(&regexes[i], regex, REG_EXTENDED | REG_NOSUB);
+	}
+
+	start = now();
+	for (int it = 0; it < ITERATIONS; ++it)
+	{
+		for (size_t n = 0; n < COUNT(names); ++n)
+		{
+			debug_glob_scan(&subjects[n], names[n]);
+			for (size_t p = 0; p < COUNT(patterns); ++p)
+				hits_glob += debug_glob_match(&globs[p], &subjects[n]);
+		}
+	}
+	glob_ns = (now() - start) / matches;
+
+	start = now();
+	for (int it = 0; it < ITERATIONS / 20; ++it)
+	{
+		for (size_t n = 0; n < COUNT(names); ++n)
+		{
+			for (size_t p = 0; p < COUNT(patterns); ++p)
+				hits_regex += regexec(&regexes[p], names[n], 0, NULL, 0) == 0;
+		}
+	}
+	regex_ns = (now() - start) / (matches / 20);
+
+	printf("%-8s %10s %10s\n", "engine", "ns/match", "hits");
+	printf("%-8s %10.1f %10lu\n", "glob", glob_ns, hits_glob / ITERATIONS);
+	printf("%-8s %10.1f %10lu\n", "regex", regex_ns, hits_regex / (ITERATIONS / 20));
+	printf("speedup  %9.1fx\n", regex_ns / glob_ns);
+
+	for (size_t i = 0; i < COUNT(patterns); ++i)
+		regfree(&regexes[i]);
+	return hits_glob / ITERATIONS != hits_regex / (ITERATIONS / 20);
+}
@@ -0,0 +1,71 @@
+/*******************************************************************************
+ * @file		hex.c
+ * @brief		Cost of a 4 KiB buffer dump: encoder against a printf("%02x")
+ *				loop, then the statement off, filtered out, emitted
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#include "../src/debug.h"
+#include "bench.h"
+
+#define BENCH_HEX_SIZE 4096
+#define BENCH_HEX_LOOPS 20000
+
+static unsigned char packet[BENCH_HEX_SIZE];
+static char out[BENCH_HEX_SIZE / 16 * DEBUG_HEX_LINE + DEBUG_HEX_SKIP];
+
+/**
+ * @brief What call sites write without a dump: one snprintf per byte
+ */
+static size_t naive(char *p, const unsigned char *data, size_t len)
+{
+	char *start = p;
+
+	for (size_t i = 0; i < len; ++i)
+	{
+		if (i % 16 == 0)
+			p += sprintf(p, "\n%08zx ", i);
+		p += sprintf(p, " %02x", data[i]);
+	}
+	return p - start;
+}
+
+static void body(long calls)
+{
+	for (long i = 0; i < calls; ++i)
+		printf_trace_hex(packet, sizeof(packet));
+}
+
+int main(void)
+{
+	volatile size_t sink = 0;
+	double start;
+
+	for (size_t i = 0; i < sizeof(packet); ++i)
+		packet[i] = i * 7;
+	debug_hex.head = 0; // Whole buffers
+	debug_hex.tail = 0;
+
+	start = bench_now();
+	for (int i = 0; i < BENCH_HEX_LOOPS; ++i)
+		sink += naive(out, packet, sizeof(packet));
+	printf("%-27s %12.2f ns per 4 KiB\n", "printf(\"%02x\") loop", (bench_now() - start) / BENCH_HEX_LOOPS);
+	start = bench_now();
+	for (int i = 0; i < BENCH_HEX_LOOPS; ++i)
+		sink += debug_hex_lines(out, packet, sizeof(packet));
+	printf("%-27s %12.2f ns per 4 KiB\n", "debug_hex_lines()", (bench_now() - start) / BENCH_HEX_LOOPS);
+	fflush(stdout);
+
+	(void)sink;
+	bench_run("hex", body);
+	return 0;
+}
@@ -0,0 +1,57 @@
+#!/bin/sh
+################################################################################
+# @file		size.sh
+# @brief	Zero cost when disabled: bench/disabled.c and bench/disabled.cpp
+#			built without DEBUG, with their statements and without any
+# @date		Sa Oct 2026
+# @author	Dimitri Simon
+#
+# PROJECT:	DEBUG
+#
+# Copyright (c) 2026 Dimitri Simon
+#
+################################################################################
+
+build=${1:-build}
+status=0
+
+# Instructions of the whole executable
+instructions()
+{
+	objdump -d --no-show-raw-insn "$1" | grep -cE '^ +[0-9a-f]+:'
+}
+
+text()
+{
+	size "$1" | awk 'NR == 2 { print $1 }'
+}
+
+printf '%-4s %-4s %12s %12s %12s %12s\n' "" "" "text" "bare text" "insns" "bare insns"
+for lang in c cpp; do
+	if [ "$lang" = c ]; then
+		cc="gcc"
+	else
+		cc="g++ -std=c++20"
+	fi
+	for opt in -O0 -O1 -O2 -Os; do
+		$cc "bench/disabled.$lang" -o "$build/disabled" $opt -Wall || exit 1
+		$cc "bench/disabled.$lang" -o "$build/disabled-bare" $opt -Wall -DBENCH_BARE || exit 1
+		t=$(text "$build/disabled")
+		tb=$(text "$build/disabled-bare")
+		i=$(instructions "$build/disabled")
+		ib=$(instructions "$build/disabled-bare")
+		verdict=""
+		if [ "$t" != "$tb" ] || [ "$i" != "$ib" ]; then
+			# Without optimization, the operands of C++ statements remain
+			if [ "$opt" = -O0 ] && [ "$lang" = cpp ]; then
+				verdict="(operands)"
+			else
+				verdict="REGRESSION"
+				status=1
+			fi
+		fi
+		printf '%-4s %-4s %12s %12s %12s %12s %s\n' "$lang" "$opt" "$t" "$tb" "$i" "$ib" "$verdict"
+	done
+done
+rm -f "$build/disabled" "$build/disabled-bare"
+exit $status
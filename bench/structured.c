@@ -0,0 +1,29 @@
+/*******************************************************************************
+ * @file		structured.c
+ * @brief		Cost of a C record with fields, as text, JSON and logfmt
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#include "../src/debug.h"
+#include "bench.h"
+
+static void body(long calls)
+{
+	for (long i = 0; i < calls; ++i)
+		printf_trace_kv("request \"done\"", DEBUG_KV("user", i), DEBUG_KV("ms", 1.25), DEBUG_KV("path", "/index.html"));
+}
+
+int main(void)
+{
+	bench_formats("C", body);
+	return 0;
+}
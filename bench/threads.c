@@ -0,0 +1,168 @@
+/*******************************************************************************
+ * @file		threads.c
+ * @brief		C API under concurrency: integrity check, then throughput
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/debug.h"
+
+#define STRESS_THREADS 32
+#define STRESS_RECORDS 5000
+#define RECORDS 200000
+
+static const int threads[] = {1, 2, 4, 8, 16, 32};
+
+#define COUNT(a) (sizeof(a) / sizeof(*(a)))
+
+struct worker
+{
+	pthread_t thread;
+	int id;
+	int records;
+	pthread_barrier_t *start;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief Every thread reaches the sites for the first time together
+ */
+static void *emit(void *arg)
+{
+	struct worker *w = (struct worker *)arg;
+
+	pthread_barrier_wait(w->start);
+	for (int i = 0; i < w->records; ++i)
+	{
+		printf_info("thread %d record %d %s", w->id, i, "-------------------------------- padding --------------------------------");
+		printf_trace("filtered out %d", i);
+	}
+	return NULL;
+}
+
+static void *filtered(void *arg)
+{
+	struct worker *w = (struct worker *)arg;
+
+	pthread_barrier_wait(w->start);
+	for (int i = 0; i < w->records; ++i)
+		printf_trace("filtered out %d", i);
+	return NULL;
+}
+
+/**
+ * @brief Run count threads, DEBUG_OUT redirected to fd
+ * @return Elapsed ns
+ */
+static double run(void *(*body)(void *), int count, int records, int fd)
+{
+	struct worker workers[STRESS_THREADS];
+	pthread_barrier_t start;
+	int saved = dup(DEBUG_OUT);
+	double begin;
+
+	fflush(NULL);
+	dup2(fd, DEBUG_OUT);
+	pthread_barrier_init(&start, NULL, count + 1);
+	for (int i = 0; i < count; ++i)
+	{
+		workers[i] = (struct worker){0, i, records, &start};
+		pthread_create(&workers[i].thread, NULL, body, &workers[i]);
+	}
+	begin = now();
+	pthread_barrier_wait(&start);
+	for (int i = 0; i < count; ++i)
+		pthread_join(workers[i].thread, NULL);
+	fflush(NULL);
+	begin = now() - begin;
+	dup2(saved, DEBUG_OUT);
+	close(saved);
+	pthread_barrier_destroy(&start);
+	return begin;
+}
+
+/**
+ * @brief Each line whole, each thread's records all there and in order
+ */
+static int check(FILE *in)
+{
+	int next[STRESS_THREADS] = {0};
+	char line[4096];
+	int lines = 0;
+	int errors = 0;
+
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		const char *p = strstr(line, "thread ");
+		int thread;
+		int record;
+		char padding[128];
+
+		++lines;
+		if (p == NULL || sscanf(p, "thread %d record %d %127s", &thread, &record, padding) != 3 || thread < 0 || thread >= STRESS_THREADS || record != next[thread] || line[strlen(line) - 1] != '\n' || strstr(line, "padding --------------------------------\n") == NULL)
+		{
+			if (errors++ < 5)
+				printf("corrupted line %d: %s", lines, line);
+			continue;
+		}
+		++next[thread];
+	}
+	for (int i = 0; i < STRESS_THREADS; ++i)
+		errors += next[i] != STRESS_RECORDS;
+	printf("stress   %d threads x %d records: %d lines, %s\n", STRESS_THREADS, STRESS_RECORDS, lines, errors == 0 ? "ok" : "FAILED");
+	return errors != 0;
+}
+
+int main(void)
+{
+	FILE *tmp = tmpfile();
+	int null = open("/dev/null", O_WRONLY);
+	int failed;
+
+	setenv("DEBUG", "4", 1);
+	if (tmp == NULL || null < 0)
+	{
+		perror("bench-threads");
+		return 1;
+	}
+	run(emit, STRESS_THREADS, STRESS_RECORDS, fileno(tmp));
+	rewind(tmp);
+	failed = check(tmp);
+	fclose(tmp);
+
+	printf("%-8s %14s %14s\n", "threads", "emitted/s", "filtered/s");
+	for (size_t i = 0; i < COUNT(threads); ++i)
+	{
+		int records = RECORDS / threads[i];
+		double emitted = run(emit, threads[i], records, null);
+		double skipped = run(filtered, threads[i], records * 100, null);
+
+		printf("%-8d %14.0f %14.0f\n", threads[i], threads[i] * records / (emitted / 1e9), threads[i] * records * 100.0 / (skipped / 1e9));
+	}
+	printf("(%ld CPUs online)\n", sysconf(_SC_NPROCESSORS_ONLN));
+	close(null);
+	return failed;
+}
@@ -0,0 +1,46 @@
+/*******************************************************************************
+ * @file		timer.c
+ * @brief		Cost of a C timed scope: DEBUG_TIMER_BEGIN() and DEBUG_TIMER_END()
+ *				around nothing, against a clock_gettime() pair
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#include "../src/debug.h"
+#include "bench.h"
+
+#define BENCH_TIMER_LOOPS 20000000
+
+static void body(long calls)
+{
+	for (long i = 0; i < calls; ++i)
+	{
+		DEBUG_TIMER_BEGIN(bench);
+		__asm__ volatile("" ::: "memory");
+		DEBUG_TIMER_END(bench);
+	}
+}
+
+int main(void)
+{
+	volatile uint64_t sink = 0;
+	double start;
+
+	start = bench_now();
+	for (int i = 0; i < BENCH_TIMER_LOOPS; ++i)
+		sink += debug_clock_read(CLOCK_MONOTONIC) - debug_clock_read(CLOCK_MONOTONIC);
+	printf("%-27s %12.2f ns per scope\n", "clock_gettime() pair", (bench_now() - start) / BENCH_TIMER_LOOPS);
+	fflush(stdout);
+
+	(void)sink;
+	bench_run("C", body);
+	return 0;
+}
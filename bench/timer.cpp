@@ -0,0 +1,32 @@
+/*******************************************************************************
+ * @file		timer.cpp
+ * @brief		Cost of a C++ timed scope: debug::scope_timer around nothing
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#include "../src/debug.hpp"
+#include "bench.h"
+
+static void body(long calls)
+{
+	for (long i = 0; i < calls; ++i)
+	{
+		debug::scope_timer timer("bench");
+		__asm__ volatile("" ::: "memory");
+	}
+}
+
+int main(void)
+{
+	bench_run("C++", body);
+	return 0;
+}
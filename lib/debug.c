@@ -0,0 +1,23 @@
+/*******************************************************************************
+ * @file		debug.c
+ * @brief		libdebug: a single copy of the helpers of the headers, for the
+ *				programs built with DEBUG_LIBRARY
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#define DEBUG_IMPLEMENTATION
+
+#ifndef DEBUG
+#define DEBUG
+#endif // DEBUG
+
+#include "../src/debug.h"
@@ -0,0 +1,409 @@
+/*******************************************************************************
+ * @file		async.h
+ * @brief		Asynchronous output: lock-free ring and a writer thread
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_ASYNC_H
+#define DEBUG_ASYNC_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+
+#ifndef DEBUG_ASYNC_SLOTS
+#define DEBUG_ASYNC_SLOTS 4096 // Power of 2
+#endif // DEBUG_ASYNC_SLOTS
+#ifndef DEBUG_ASYNC_RECORD
+#define DEBUG_ASYNC_RECORD 496 // Longer records are written directly
+#endif // DEBUG_ASYNC_RECORD
+#ifndef DEBUG_ASYNC_BATCH
+#define DEBUG_ASYNC_BATCH 65536
+#endif // DEBUG_ASYNC_BATCH
+
+struct debug_async_slot
+{
+	size_t seq;
+	int fd;
+	unsigned len;
+	char data[DEBUG_ASYNC_RECORD];
+};
+
+/**
+ * @brief Bounded multi-producer ring (D. Vyukov), drained by one thread
+ * @details A slot is free for position pos when seq == pos, and holds
+ * the record of pos when seq == pos + 1.
+ */
+struct debug_async
+{
+	int running;
+	int stopping;
+	int configured; // DEBUG_ASYNC read
+	enum debug_overflow policy;
+	struct debug_async_slot *slots;
+	pthread_t thread;
+	pthread_mutex_t control; // Start and stop
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	int sleeping;
+	unsigned long dropped;
+	size_t written;
+	size_t producers; // Inside debug_async_write()
+	__attribute__((aligned(64))) size_t head;
+	__attribute__((aligned(64))) size_t tail;
+};
+
+DEBUG_SHARED struct debug_async debug_async = {0, 0, 0, DEBUG_OVERFLOW_BLOCK, NULL, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0, 0, 0, 0};
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief write(2) all of it
+ */
+DEBUG_INTERNAL void debug_write(int fd, const char *buf, size_t len)
+{
+	while (len != 0)
+	{
+		ssize_t n = write(fd, buf, len);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return;
+		buf += n;
+		len -= n;
+	}
+}
+
+DEBUG_INTERNAL int debug_async_push(const char *buf, size_t len, int fd)
+{
+	struct debug_async_slot *slot;
+	size_t pos = __atomic_load_n(&debug_async.head, __ATOMIC_RELAXED);
+
+	for (;;)
+	{
+		slot = &debug_async.slots[pos & (DEBUG_ASYNC_SLOTS - 1)];
+		size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		long dif = (long)(seq - pos);
+
+		if (dif == 0)
+		{
+			if (__atomic_compare_exchange_n(&debug_async.head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		}
+		else if (dif < 0)
+			return -1; // Full
+		else
+			pos = __atomic_load_n(&debug_async.head, __ATOMIC_RELAXED);
+	}
+	memcpy(slot->data, buf, len);
+	slot->len = len;
+	slot->fd = fd;
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/**
+ * @brief Take the oldest record
+ * @return The slot, to give back with debug_async_release(), NULL when empty
+ */
+DEBUG_INTERNAL struct debug_async_slot *debug_async_pop(size_t *ppos)
+{
+	struct debug_async_slot *slot;
+	size_t pos = __atomic_load_n(&debug_async.tail, __ATOMIC_RELAXED);
+
+	for (;;)
+	{
+		slot = &debug_async.slots[pos & (DEBUG_ASYNC_SLOTS - 1)];
+		size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		long dif = (long)(seq - (pos + 1));
+
+		if (dif == 0)
+		{
+			if (__atomic_compare_exchange_n(&debug_async.tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		}
+		else if (dif < 0)
+			return NULL; // Empty
+		else
+			pos = __atomic_load_n(&debug_async.tail, __ATOMIC_RELAXED);
+	}
+	*ppos = pos;
+	return slot;
+}
+
+DEBUG_INTERNAL void debug_async_release(struct debug_async_slot *slot, size_t pos)
+{
+	__atomic_store_n(&slot->seq, pos + DEBUG_ASYNC_SLOTS, __ATOMIC_RELEASE);
+}
+
+DEBUG_INTERNAL void debug_async_wake(void)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (!__atomic_load_n(&debug_async.sleeping, __ATOMIC_RELAXED))
+		return;
+	pthread_mutex_lock(&debug_async.lock);
+	pthread_cond_signal(&debug_async.wake);
+	pthread_mutex_unlock(&debug_async.lock);
+}
+
+/**
+ * @brief Writer thread: gathers records into large writes, one per fd
+ */
+DEBUG_INTERNAL void *debug_async_main(void *arg)
+{
+	static char batch[DEBUG_ASYNC_BATCH];
+	size_t len = 0;
+	size_t count = 0;
+	int fd = -1;
+
+	(void)arg;
+	for (;;)
+	{
+		size_t pos;
+		struct debug_async_slot *slot = debug_async_pop(&pos);
+
+		if (slot != NULL && (slot->fd != fd || len + slot->len > sizeof(batch)) && len != 0)
+		{
+			debug_write(fd, batch, len);
+			__atomic_add_fetch(&debug_async.written, count, __ATOMIC_RELEASE);
+			len = 0;
+			count = 0;
+		}
+		if (slot != NULL)
+		{
+			fd = slot->fd;
+			memcpy(batch + len, slot->data, slot->len);
+			len += slot->len;
+			++count;
+			debug_async_release(slot, pos);
+			continue;
+		}
+
+		// Empty
+		if (len != 0)
+		{
+			debug_write(fd, batch, len);
+			__atomic_add_fetch(&debug_async.written, count, __ATOMIC_RELEASE);
+			len = 0;
+			count = 0;
+		}
+		if (__atomic_load_n(&debug_async.stopping, __ATOMIC_ACQUIRE))
+			return NULL;
+
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += 50000000;
+		if (deadline.tv_nsec >= 1000000000)
+		{
+			deadline.tv_sec += 1;
+			deadline.tv_nsec -= 1000000000;
+		}
+		pthread_mutex_lock(&debug_async.lock);
+		__atomic_store_n(&debug_async.sleeping, 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&debug_async.head, __ATOMIC_RELAXED) == __atomic_load_n(&debug_async.tail, __ATOMIC_RELAXED) && !__atomic_load_n(&debug_async.stopping, __ATOMIC_RELAXED))
+			pthread_cond_timedwait(&debug_async.wake, &debug_async.lock, &deadline);
+		__atomic_store_n(&debug_async.sleeping, 0, __ATOMIC_RELAXED);
+		pthread_mutex_unlock(&debug_async.lock);
+	}
+}
+
+/**
+ * @brief Queue a record for the writer thread
+ * @return 0, -1 when async mode is off or the record is too long
+ * @details Counted in debug_async.producers, so that debug_async_stop()
+ * lets it finish before draining the ring for the last time.
+ */
+DEBUG_INTERNAL int debug_async_write(int fd, const char *buf, size_t len)
+{
+	if (len > DEBUG_ASYNC_RECORD)
+		return -1;
+	__atomic_add_fetch(&debug_async.producers, 1, __ATOMIC_SEQ_CST);
+	if (!__atomic_load_n(&debug_async.running, __ATOMIC_SEQ_CST))
+	{
+		__atomic_sub_fetch(&debug_async.producers, 1, __ATOMIC_RELEASE);
+		return -1;
+	}
+
+	while (debug_async_push(buf, len, fd) != 0)
+	{
+		size_t pos;
+		struct debug_async_slot *slot;
+
+		switch (debug_async.policy)
+		{
+		case DEBUG_OVERFLOW_DROP_NEWEST:
+			__atomic_add_fetch(&debug_async.dropped, 1, __ATOMIC_RELAXED);
+			__atomic_sub_fetch(&debug_async.producers, 1, __ATOMIC_RELEASE);
+			return 0;
+		case DEBUG_OVERFLOW_DROP_OLDEST:
+			slot = debug_async_pop(&pos);
+			if (slot != NULL)
+			{
+				debug_async_release(slot, pos);
+				__atomic_add_fetch(&debug_async.dropped, 1, __ATOMIC_RELAXED);
+				__atomic_add_fetch(&debug_async.written, 1, __ATOMIC_RELEASE);
+			}
+			break;
+		default:
+			if (!__atomic_load_n(&debug_async.running, __ATOMIC_ACQUIRE))
+			{
+				// Stopping, do not wait for room any more
+				__atomic_sub_fetch(&debug_async.producers, 1, __ATOMIC_RELEASE);
+				debug_write(fd, buf, len);
+				return 0;
+			}
+			debug_async_wake();
+			sched_yield();
+			break;
+		}
+	}
+	__atomic_sub_fetch(&debug_async.producers, 1, __ATOMIC_RELEASE);
+	debug_async_wake();
+	return 0;
+}
+
+/**
+ * @brief Wait for the records queued so far to be written
+ */
+DEBUG_INTERNAL void debug_async_flush(void)
+{
+	size_t head = __atomic_load_n(&debug_async.head, __ATOMIC_ACQUIRE);
+
+	if (!__atomic_load_n(&debug_async.running, __ATOMIC_ACQUIRE))
+		return;
+	// Records dropped when full never took a position, the oldest ones are counted as written
+	while (__atomic_load_n(&debug_async.written, __ATOMIC_ACQUIRE) < head)
+	{
+		struct timespec ts = {0, 100000};
+
+		debug_async_wake();
+		nanosleep(&ts, NULL);
+	}
+}
+
+/**
+ * @brief Drain the ring and stop the writer thread
+ * @details Waits for the records being queued, the writer thread still
+ * draining the ring meanwhile.
+ */
+DEBUG_INTERNAL void debug_async_stop(void)
+{
+	pthread_mutex_lock(&debug_async.control);
+	if (!__atomic_exchange_n(&debug_async.running, 0, __ATOMIC_SEQ_CST))
+	{
+		pthread_mutex_unlock(&debug_async.control);
+		return;
+	}
+	while (__atomic_load_n(&debug_async.producers, __ATOMIC_SEQ_CST) != 0)
+	{
+		debug_async_wake();
+		sched_yield();
+	}
+
+	pthread_mutex_lock(&debug_async.lock);
+	__atomic_store_n(&debug_async.stopping, 1, __ATOMIC_RELEASE);
+	pthread_cond_signal(&debug_async.wake);
+	pthread_mutex_unlock(&debug_async.lock);
+	pthread_join(debug_async.thread, NULL);
+
+	if (debug_async.dropped != 0)
+	{
+		char msg[96];
+		int len = snprintf(msg, sizeof(msg), "DEBUG: %lu records dropped\n", debug_async.dropped);
+
+		debug_write(STDERR_FILENO, msg, len);
+	}
+	pthread_mutex_unlock(&debug_async.control);
+}
+
+/**
+ * @brief Start writing records from a dedicated thread
+ * @param policy What to do when the ring is full
+ * @details Stopped at exit, once every queued record is written.
+ */
+DEBUG_INTERNAL int debug_async_start(enum debug_overflow policy)
+{
+	static int registered;
+
+	pthread_mutex_lock(&debug_async.control);
+	if (__atomic_load_n(&debug_async.running, __ATOMIC_ACQUIRE))
+	{
+		pthread_mutex_unlock(&debug_async.control);
+		return 0;
+	}
+	if (debug_async.slots == NULL)
+	{
+		debug_async.slots = (struct debug_async_slot *)calloc(DEBUG_ASYNC_SLOTS, sizeof(struct debug_async_slot));
+		if (debug_async.slots == NULL)
+		{
+			pthread_mutex_unlock(&debug_async.control);
+			return -1;
+		}
+	}
+	for (size_t i = 0; i < DEBUG_ASYNC_SLOTS; ++i)
+		debug_async.slots[i].seq = i;
+	debug_async.head = 0;
+	debug_async.tail = 0;
+	debug_async.written = 0;
+	debug_async.stopping = 0;
+	debug_async.policy = policy;
+	fflush(NULL);
+	if (pthread_create(&debug_async.thread, NULL, debug_async_main, NULL) != 0)
+	{
+		pthread_mutex_unlock(&debug_async.control);
+		return -1;
+	}
+	__atomic_store_n(&debug_async.running, 1, __ATOMIC_SEQ_CST);
+	if (!registered)
+	{
+		registered = 1;
+		atexit(debug_async_stop);
+	}
+	pthread_mutex_unlock(&debug_async.control);
+	return 0;
+}
+
+/**
+ * @brief Start async mode from DEBUG_ASYNC=block|drop-newest|drop-oldest
+ * @details Only the first call reads it.
+ */
+DEBUG_INTERNAL void debug_async_env(void)
+{
+	const char *var;
+
+	if (__atomic_exchange_n(&debug_async.configured, 1, __ATOMIC_ACQ_REL))
+		return;
+	var = getenv("DEBUG_ASYNC");
+	if (var == NULL || var[0] == '\0')
+		return;
+	if (strcmp(var, "drop-newest") == 0)
+		debug_async_start(DEBUG_OVERFLOW_DROP_NEWEST);
+	else if (strcmp(var, "drop-oldest") == 0)
+		debug_async_start(DEBUG_OVERFLOW_DROP_OLDEST);
+	else
+		debug_async_start(DEBUG_OVERFLOW_BLOCK);
+}
+#else
+DEBUG_INTERNAL void debug_async_flush(void);
+DEBUG_INTERNAL void debug_async_stop(void);
+DEBUG_INTERNAL int debug_async_start(enum debug_overflow policy);
+#endif // DEBUG_DEFINITIONS
+
+#endif // DEBUG_ASYNC_H
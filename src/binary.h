@@ -0,0 +1,561 @@
+/*******************************************************************************
+ * @file		binary.h
+ * @brief		Binary output: records are formatted later, by debug-decode
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_BINARY_H
+#define DEBUG_BINARY_H
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "async.h"
+#include "filter.h"
+#include "recorder.h"
+#include "stamp.h"
+
+/*
+ * Stream layout, native byte order:
+ *  header  "DBGBIN1\n", i64 realtime - monotonic (ns)
+ *  site    'S', u32 id, i8 level, u8 kind, u32 line, u16 file, u16 func, u16 format, strings
+ *  record  'R', u32 id, u64 monotonic (ns), u32 size, arguments
+ * Each argument is a DEBUG_ARG_* byte followed by its value; strings are u16 length, bytes.
+ * A site is written before any of its records. The flight recorder (recorder.h)
+ * keeps the same sites and records.
+ */
+#define DEBUG_BINARY_MAGIC "DBGBIN1\n"
+#define DEBUG_BINARY_HEADER 17 // Of a record
+
+#ifndef DEBUG_BINARY_BUFFER
+#define DEBUG_BINARY_BUFFER 65536 // Per thread
+#endif // DEBUG_BINARY_BUFFER
+#ifndef DEBUG_BINARY_STRING
+#define DEBUG_BINARY_STRING 1024 // Longer strings are truncated
+#endif // DEBUG_BINARY_STRING
+
+/** Kind of site */
+#define DEBUG_KIND_C 0	 // printf format
+#define DEBUG_KIND_CPP 1 // Operands of <<
+
+/** Type of an argument */
+#define DEBUG_ARG_NONE 0
+#define DEBUG_ARG_I32 1
+#define DEBUG_ARG_I64 2
+#define DEBUG_ARG_U64 3
+#define DEBUG_ARG_DOUBLE 4
+#define DEBUG_ARG_LDOUBLE 5
+#define DEBUG_ARG_STRING 6
+#define DEBUG_ARG_POINTER 7
+#define DEBUG_ARG_CHAR 8
+#define DEBUG_ARG_BOOL 9
+
+/**
+ * @brief A conversion of a printf format
+ */
+struct debug_conversion
+{
+	const char *start; // '%'
+	size_t len;		   // Up to the conversion character, included
+	int stars;		   // '*' width and precision, an int each
+	int type;		   // DEBUG_ARG_*
+};
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief Find the next conversion of a printf format
+ * @return What follows it, NULL when there is none left
+ */
+DEBUG_INTERNAL const char *debug_conversion(const char *format, struct debug_conversion *conv)
+{
+	const char *p = strchr(format, '%');
+	int wide = 0;
+	int ldouble = 0;
+
+	if (p == NULL)
+		return NULL;
+	conv->start = p++;
+	conv->stars = 0;
+	while (*p != '\0' && strchr("-+ #0'", *p) != NULL)
+		++p;
+	if (*p == '*')
+	{
+		++conv->stars;
+		++p;
+	}
+	while (*p >= '0' && *p <= '9')
+		++p;
+	if (*p == '.')
+	{
+		if (*++p == '*')
+		{
+			++conv->stars;
+			++p;
+		}
+		while (*p >= '0' && *p <= '9')
+			++p;
+	}
+	for (;; ++p)
+	{
+		if (*p == 'l' || *p == 'j' || *p == 'z' || *p == 't' || *p == 'q')
+			wide = 1;
+		else if (*p == 'L')
+			ldouble = 1;
+		else if (*p != 'h')
+			break;
+	}
+	switch (*p)
+	{
+	case 'd':
+	case 'i':
+	case 'u':
+	case 'x':
+	case 'X':
+	case 'o':
+		conv->type = wide ? DEBUG_ARG_I64 : DEBUG_ARG_I32;
+		break;
+	case 'c':
+		conv->type = DEBUG_ARG_I32;
+		break;
+	case 'e':
+	case 'E':
+	case 'f':
+	case 'F':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+		conv->type = ldouble ? DEBUG_ARG_LDOUBLE : DEBUG_ARG_DOUBLE;
+		break;
+	case 's':
+		conv->type = wide ? DEBUG_ARG_POINTER : DEBUG_ARG_STRING;
+		break;
+	case 'p':
+	case 'n':
+		conv->type = DEBUG_ARG_POINTER;
+		break;
+	case '\0':
+		conv->type = DEBUG_ARG_NONE;
+		conv->len = p - conv->start;
+		return p;
+	default: // "%%", "%m"
+		conv->type = DEBUG_ARG_NONE;
+		break;
+	}
+	conv->len = p + 1 - conv->start;
+	return p + 1;
+}
+#endif // DEBUG_DEFINITIONS
+
+struct debug_binary_buffer
+{
+	int busy; // Held by the owner while appending, and to flush it at exit
+	size_t len;
+	struct debug_binary_buffer *next;
+	char data[DEBUG_BINARY_BUFFER];
+};
+
+struct debug_binary
+{
+	int configured; // DEBUG_BINARY read
+	int fd;			// -1 when off
+	unsigned next_id;
+	pthread_mutex_t lock;
+	pthread_key_t key;
+	struct debug_binary_buffer *buffers; // Of every thread
+};
+
+DEBUG_SHARED struct debug_binary debug_binary = {0, -1, 0, PTHREAD_MUTEX_INITIALIZER, 0, NULL};
+DEBUG_SHARED __thread struct debug_binary_buffer *debug_binary_buffer;
+
+#define debug_binary_on() \
+	__builtin_expect(debug_binary.fd >= 0, 0)
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief Timestamp of a record, see DEBUG_CLOCK
+ */
+DEBUG_INTERNAL uint64_t debug_binary_now(void)
+{
+	return debug_clock_now(1);
+}
+
+DEBUG_INTERNAL void debug_binary_hold(struct debug_binary_buffer *buffer)
+{
+	while (__atomic_exchange_n(&buffer->busy, 1, __ATOMIC_ACQUIRE))
+		sched_yield();
+}
+
+DEBUG_INTERNAL void debug_binary_unhold(struct debug_binary_buffer *buffer)
+{
+	__atomic_store_n(&buffer->busy, 0, __ATOMIC_RELEASE);
+}
+
+DEBUG_INTERNAL void debug_binary_flush_buffer(struct debug_binary_buffer *buffer)
+{
+	if (buffer->len == 0)
+		return;
+	debug_write(debug_binary.fd, buffer->data, buffer->len);
+	buffer->len = 0;
+}
+
+/**
+ * @brief Flush what every thread buffered
+ * @details The threads still running finish the record they are appending first.
+ */
+DEBUG_INTERNAL void debug_binary_flush(void)
+{
+	if (debug_binary.fd < 0)
+		return;
+	pthread_mutex_lock(&debug_binary.lock);
+	for (struct debug_binary_buffer *buffer = debug_binary.buffers; buffer != NULL; buffer = buffer->next)
+	{
+		debug_binary_hold(buffer);
+		debug_binary_flush_buffer(buffer);
+		debug_binary_unhold(buffer);
+	}
+	pthread_mutex_unlock(&debug_binary.lock);
+}
+
+/**
+ * @brief A thread ends, flush and forget its buffer
+ */
+DEBUG_INTERNAL void debug_binary_release(void *arg)
+{
+	struct debug_binary_buffer *buffer = (struct debug_binary_buffer *)arg;
+
+	pthread_mutex_lock(&debug_binary.lock);
+	debug_binary_flush_buffer(buffer);
+	for (struct debug_binary_buffer **p = &debug_binary.buffers; *p != NULL; p = &(*p)->next)
+	{
+		if (*p == buffer)
+		{
+			*p = buffer->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&debug_binary.lock);
+	free(buffer);
+}
+
+/**
+ * @brief Open the file given by DEBUG_BINARY
+ */
+DEBUG_INTERNAL void debug_binary_env(void)
+{
+	const char *path = getenv("DEBUG_BINARY");
+	struct timespec real;
+	int64_t offset;
+	char header[sizeof(DEBUG_BINARY_MAGIC) - 1 + sizeof(offset)];
+	int fd;
+
+	if (__atomic_exchange_n(&debug_binary.configured, 1, __ATOMIC_ACQ_REL))
+		return;
+	if (path == NULL || path[0] == '\0')
+		return;
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		perror("DEBUG_BINARY");
+		return;
+	}
+	clock_gettime(CLOCK_REALTIME, &real);
+	offset = ((int64_t)real.tv_sec * 1000000000 + real.tv_nsec) - (int64_t)debug_binary_now();
+	memcpy(header, DEBUG_BINARY_MAGIC, sizeof(DEBUG_BINARY_MAGIC) - 1);
+	memcpy(header + sizeof(DEBUG_BINARY_MAGIC) - 1, &offset, sizeof(offset));
+	debug_write(fd, header, sizeof(header));
+
+	pthread_key_create(&debug_binary.key, debug_binary_release);
+	atexit(debug_binary_flush);
+	__atomic_store_n(&debug_binary.fd, fd, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Room for size bytes in the buffer of the thread
+ * @details Held until debug_binary_commit().
+ */
+DEBUG_INTERNAL char *debug_binary_reserve(size_t size)
+{
+	struct debug_binary_buffer *buffer = debug_binary_buffer;
+
+	if (__builtin_expect(buffer == NULL, 0))
+	{
+		buffer = (struct debug_binary_buffer *)malloc(sizeof(*buffer));
+		if (buffer == NULL)
+			return NULL;
+		buffer->busy = 0;
+		buffer->len = 0;
+		pthread_mutex_lock(&debug_binary.lock);
+		buffer->next = debug_binary.buffers;
+		debug_binary.buffers = buffer;
+		pthread_mutex_unlock(&debug_binary.lock);
+		pthread_setspecific(debug_binary.key, buffer);
+		debug_binary_buffer = buffer;
+	}
+	debug_binary_hold(buffer);
+	if (buffer->len + size > sizeof(buffer->data))
+		debug_binary_flush_buffer(buffer);
+	return buffer->data + buffer->len;
+}
+
+DEBUG_INTERNAL void debug_binary_commit(char *end)
+{
+	debug_binary_buffer->len = end - debug_binary_buffer->data;
+	debug_binary_unhold(debug_binary_buffer);
+}
+
+DEBUG_INTERNAL unsigned debug_binary_types(const char *format, unsigned char *types, unsigned max);
+
+/**
+ * @brief Give an id to a site, writing its description first
+ * @param id Where the id of the site is kept, 0 until then
+ * @param types Filled with the types of the arguments of format, for C sites
+ * @param count How many types
+ */
+DEBUG_INTERNAL unsigned debug_binary_define(unsigned *id, int level, int kind, const char *file, const char *func, unsigned line, const char *format, unsigned char *types, unsigned char *count)
+{
+	uint16_t lens[3] = {(uint16_t)strlen(file), (uint16_t)strlen(func), (uint16_t)strlen(format)};
+	size_t size = 1 + 4 + 1 + 1 + 4 + sizeof(lens) + lens[0] + lens[1] + lens[2];
+	char *def = (char *)malloc(size);
+	char *p = def;
+	int8_t lvl = level;
+	uint8_t knd = kind;
+	uint32_t ln = line;
+	unsigned ret;
+
+	if (def == NULL)
+		return 0;
+	pthread_mutex_lock(&debug_binary.lock);
+	ret = *id;
+	if (ret == 0)
+	{
+		if (types != NULL)
+			*count = debug_binary_types(format, types, DEBUG_SITE_ARGS);
+		ret = ++debug_binary.next_id;
+		*p++ = 'S';
+		memcpy(p, &ret, 4);
+		p += 4;
+		memcpy(p++, &lvl, 1);
+		memcpy(p++, &knd, 1);
+		memcpy(p, &ln, 4);
+		p += 4;
+		memcpy(p, lens, sizeof(lens));
+		p += sizeof(lens);
+		memcpy(p, file, lens[0]);
+		memcpy(p + lens[0], func, lens[1]);
+		memcpy(p + lens[0] + lens[1], format, lens[2]);
+		// Before any record of the site, which are buffered
+		if (debug_binary.fd >= 0)
+			debug_write(debug_binary.fd, def, size);
+		if (debug_recorder.map != NULL)
+			debug_recorder_define(def, size);
+		__atomic_store_n(id, ret, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&debug_binary.lock);
+	free(def);
+	return ret;
+}
+
+/**
+ * @brief Start a record
+ * @param size Its arguments, at most
+ * @return Where the arguments go, NULL on failure
+ */
+DEBUG_INTERNAL char *debug_binary_begin(unsigned id, size_t size)
+{
+	uint64_t now = debug_binary_now();
+	char *p = debug_binary_reserve(DEBUG_BINARY_HEADER + size);
+
+	if (p == NULL)
+		return NULL;
+	*p = 'R';
+	memcpy(p + 1, &id, 4);
+	memcpy(p + 5, &now, 8);
+	return p + DEBUG_BINARY_HEADER;
+}
+
+/**
+ * @brief Terminate the record started by debug_binary_begin()
+ */
+DEBUG_INTERNAL void debug_binary_end(char *args, char *end)
+{
+	uint32_t size = end - args;
+
+	memcpy(args - 4, &size, 4);
+	debug_binary_commit(end);
+}
+
+/**
+ * @param max Longer strings are truncated
+ */
+DEBUG_INTERNAL char *debug_binary_string(char *p, const char *s, size_t max)
+{
+	uint16_t len;
+
+	if (s == NULL)
+		s = "(null)";
+	len = strnlen(s, max);
+	*p++ = DEBUG_ARG_STRING;
+	memcpy(p, &len, 2);
+	memcpy(p + 2, s, len);
+	return p + 2 + len;
+}
+
+/**
+ * @brief Encode the arguments of a printf format
+ * @param types Of the arguments, from debug_binary_types()
+ * @param max Of a string
+ * @return The end of the arguments, at most count * (3 + max) bytes after p
+ */
+DEBUG_INTERNAL char *debug_binary_encode(char *p, const unsigned char *types, unsigned count, va_list ap, size_t max)
+{
+	for (unsigned i = 0; i < count; ++i)
+	{
+		switch (types[i])
+		{
+		case DEBUG_ARG_I32:
+		{
+			int v = va_arg(ap, int);
+			*p++ = DEBUG_ARG_I32;
+			memcpy(p, &v, sizeof(v));
+			p += sizeof(v);
+			break;
+		}
+		case DEBUG_ARG_I64:
+		{
+			long long v = va_arg(ap, long long);
+			*p++ = DEBUG_ARG_I64;
+			memcpy(p, &v, sizeof(v));
+			p += sizeof(v);
+			break;
+		}
+		case DEBUG_ARG_DOUBLE:
+		{
+			double v = va_arg(ap, double);
+			*p++ = DEBUG_ARG_DOUBLE;
+			memcpy(p, &v, sizeof(v));
+			p += sizeof(v);
+			break;
+		}
+		case DEBUG_ARG_LDOUBLE:
+		{
+			long double v = va_arg(ap, long double);
+			*p++ = DEBUG_ARG_LDOUBLE;
+			memcpy(p, &v, sizeof(v));
+			p += sizeof(v);
+			break;
+		}
+		case DEBUG_ARG_STRING:
+			p = debug_binary_string(p, va_arg(ap, const char *), max);
+			break;
+		default:
+		{
+			void *v = va_arg(ap, void *);
+			*p++ = DEBUG_ARG_POINTER;
+			memcpy(p, &v, sizeof(v));
+			p += sizeof(v);
+			break;
+		}
+		}
+	}
+	return p;
+}
+
+/**
+ * @brief Record the arguments of a printf format
+ * @param types Of the arguments, from debug_binary_types()
+ */
+DEBUG_INTERNAL void debug_binary_vprintf(unsigned id, const unsigned char *types, unsigned count, va_list ap)
+{
+	char *args = debug_binary_begin(id, count * (3 + DEBUG_BINARY_STRING));
+
+	if (args == NULL)
+		return;
+	debug_binary_end(args, debug_binary_encode(args, types, count, ap, DEBUG_BINARY_STRING));
+}
+
+/**
+ * @brief Keep the arguments of a printf format in the flight recorder
+ * @details Strings are cut at DEBUG_RECORDER_STRING, so that a ring keeps many records.
+ */
+DEBUG_INTERNAL void debug_recorder_vprintf(unsigned id, const unsigned char *types, unsigned count, va_list ap)
+{
+	char record[DEBUG_BINARY_HEADER + DEBUG_SITE_ARGS * (3 + DEBUG_RECORDER_STRING)];
+	uint64_t now = debug_binary_now();
+	uint32_t size;
+
+	record[0] = 'R';
+	memcpy(record + 1, &id, 4);
+	memcpy(record + 5, &now, 8);
+	size = debug_binary_encode(record + DEBUG_BINARY_HEADER, types, count, ap, DEBUG_RECORDER_STRING) - (record + DEBUG_BINARY_HEADER);
+	memcpy(record + 13, &size, 4);
+	debug_recorder_append(record, DEBUG_BINARY_HEADER + size);
+}
+
+/**
+ * @brief Types of the arguments of a printf format
+ * @return How many, at most max
+ */
+DEBUG_INTERNAL unsigned debug_binary_types(const char *format, unsigned char *types, unsigned max)
+{
+	struct debug_conversion conv;
+	unsigned count = 0;
+
+	while ((format = debug_conversion(format, &conv)) != NULL)
+	{
+		for (int i = 0; i < conv.stars && count < max; ++i)
+			types[count++] = DEBUG_ARG_I32;
+		if (conv.type != DEBUG_ARG_NONE && count < max)
+			types[count++] = conv.type;
+	}
+	return count;
+}
+
+/**
+ * @brief Copy a finished record (the C++ API builds them aside)
+ */
+DEBUG_INTERNAL void debug_binary_write(const char *record, size_t size)
+{
+	char *p;
+
+	if (size > DEBUG_BINARY_BUFFER)
+	{
+		if (debug_binary_buffer != NULL)
+		{
+			debug_binary_hold(debug_binary_buffer);
+			debug_binary_flush_buffer(debug_binary_buffer);
+			debug_binary_unhold(debug_binary_buffer);
+		}
+		debug_write(debug_binary.fd, record, size);
+		return;
+	}
+	p = debug_binary_reserve(size);
+	if (p == NULL)
+		return;
+	memcpy(p, record, size);
+	debug_binary_commit(p + size);
+}
+#else
+DEBUG_INTERNAL uint64_t debug_binary_now(void);
+DEBUG_INTERNAL unsigned debug_binary_define(unsigned *id, int level, int kind, const char *file, const char *func, unsigned line, const char *format, unsigned char *types, unsigned char *count);
+DEBUG_INTERNAL void debug_binary_write(const char *record, size_t size);
+#endif // DEBUG_DEFINITIONS
+
+#endif // DEBUG_BINARY_H
@@ -6,13 +6,16 @@
  * 
  * PROJECT:		DEBUG
  * 
- * MODIFIED:	Sat Dec 07 2024
+ * MODIFIED:	Sat Oct 17 2026
  * BY:			Dimitri Simon
  * 
  * Copyright (c) 2024 Dimitri Simon
  * 
  *******************************************************************************/
 
+#ifndef DEBUG_COMMON_H
+#define DEBUG_COMMON_H
+
 #define LOG_UNDEFINED (-1)
 #define LOG_NONE 0
 #define LOG_FATAL 1
@@ -38,3 +41,69 @@
 #ifndef DEBUG_SPACING_LINE
 #define DEBUG_SPACING_LINE 4
 #endif // DEBUG_SPACING_LINE
+
+/**
+ * @brief Helpers defined in the headers, one copy per translation unit
+ * @details With DEBUG_LIBRARY, only declared: those of libdebug are called.
+ * The library itself is built with DEBUG_IMPLEMENTATION.
+ */
+#if defined(DEBUG_LIBRARY) || defined(DEBUG_IMPLEMENTATION)
+#define DEBUG_INTERNAL __attribute__((unused))
+#else
+#define DEBUG_INTERNAL static __attribute__((unused))
+#endif // defined(DEBUG_LIBRARY) || defined(DEBUG_IMPLEMENTATION)
+
+/**
+ * @brief Whether the headers define their helpers, or only declare them
+ */
+#if defined(DEBUG_LIBRARY) && !defined(DEBUG_IMPLEMENTATION)
+#define DEBUG_DEFINITIONS 0
+#else
+#define DEBUG_DEFINITIONS 1
+#endif // defined(DEBUG_LIBRARY) && !defined(DEBUG_IMPLEMENTATION)
+
+/**
+ * @brief Helpers defined in every translation unit, library or not: the fast
+ * path, and those of the debug_sites section of the program or library
+ */
+#define DEBUG_LOCAL static __attribute__((unused))
+
+/**
+ * @brief Out of line, apart from the code of its callers: what runs once a
+ * statement passes
+ */
+#define DEBUG_COLD __attribute__((cold, noinline))
+
+/**
+ * @brief State shared by every translation unit including the headers
+ */
+#define DEBUG_SHARED __attribute__((weak))
+
+/**
+ * @brief What a full asynchronous ring does with a new record
+ */
+enum debug_overflow
+{
+	DEBUG_OVERFLOW_BLOCK,		// Wait for the writer thread
+	DEBUG_OVERFLOW_DROP_NEWEST, // Drop the new record
+	DEBUG_OVERFLOW_DROP_OLDEST, // Drop the oldest queued record
+};
+
+/** Level tags */
+#define DEBUG_TAG_NONE "        "
+#define DEBUG_TAG_FATAL T_OUT(T_REVERSE T_BOLD T_FG_RED) " FATAL " T_RESET " "
+#define DEBUG_TAG_ERROR T_OUT(T_BOLD T_FG_RED) " ERROR " T_RESET " "
+#define DEBUG_TAG_WARNING T_OUT(T_BOLD T_FG_YELLOW) " WARN  " T_RESET " "
+#define DEBUG_TAG_INFO T_OUT(T_BOLD T_FG_CYAN) " INFO  " T_RESET " "
+#define DEBUG_TAG_DEBUG T_OUT(T_BOLD T_FG_WHITE) " DEBUG " T_RESET " "
+#define DEBUG_TAG_TRACE T_OUT(T_REVERSE T_FG_WHITE) " TRACE " T_RESET " "
+
+/** Level tags, without colors */
+#define DEBUG_TAG_FATAL_PLAIN " FATAL  "
+#define DEBUG_TAG_ERROR_PLAIN " ERROR  "
+#define DEBUG_TAG_WARNING_PLAIN " WARN   "
+#define DEBUG_TAG_INFO_PLAIN " INFO   "
+#define DEBUG_TAG_DEBUG_PLAIN " DEBUG  "
+#define DEBUG_TAG_TRACE_PLAIN " TRACE  "
+
+#endif // DEBUG_COMMON_H
@@ -0,0 +1,183 @@
+/*******************************************************************************
+ * @file		control.h
+ * @brief		DEBUG_CONTROL_FILE: the filter of a running process, read again
+ *				when the file changes or on SIGUSR1
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_CONTROL_H
+#define DEBUG_CONTROL_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "filter.h"
+
+#ifndef DEBUG_CONTROL_SIZE
+#define DEBUG_CONTROL_SIZE 4096 // Bytes of the file read, the rest is ignored
+#endif // DEBUG_CONTROL_SIZE
+
+DEBUG_INTERNAL void debug_set_filter(const char *filter);
+
+struct debug_control
+{
+	int configured;
+	char *path;
+	const char *name; // Of the file, in the directory of path
+	int wake[2];	  // Written by SIGUSR1
+	pthread_t thread;
+};
+
+DEBUG_SHARED struct debug_control debug_control = {0, NULL, NULL, {-1, -1}, 0};
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief Replace the filter by the content of the file
+ * @details Lines are `;` separated entries as well. A file missing leaves
+ * the filter as it is.
+ */
+DEBUG_INTERNAL void debug_control_read(void)
+{
+	char filter[DEBUG_CONTROL_SIZE + 1];
+	ssize_t len = 0;
+	ssize_t n;
+	int fd = open(debug_control.path, O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0)
+		return;
+	while (len < DEBUG_CONTROL_SIZE && ((n = read(fd, filter + len, DEBUG_CONTROL_SIZE - len)) > 0 || (n < 0 && errno == EINTR)))
+		len += n > 0 ? n : 0;
+	close(fd);
+	for (ssize_t i = 0; i < len; ++i)
+		if (filter[i] == '\n' || filter[i] == '\r')
+			filter[i] = ';';
+	filter[len] = '\0';
+	debug_set_filter(filter);
+}
+
+/**
+ * @brief SIGUSR1: wake the control thread up, which reads the file
+ */
+DEBUG_INTERNAL void debug_control_signal(int sig)
+{
+	const int saved = errno;
+	const char c = (char)sig;
+
+	(void)!write(debug_control.wake[1], &c, 1);
+	errno = saved;
+}
+
+/**
+ * @brief Read the file whenever it is written, replaced or SIGUSR1 is received
+ * @details The directory is watched: editors and `mv` replace the file.
+ */
+DEBUG_INTERNAL void *debug_control_main(void *arg)
+{
+	char events[sizeof(struct inotify_event) + NAME_MAX + 1] __attribute__((aligned(__alignof__(struct inotify_event))));
+	char dir[PATH_MAX];
+	struct pollfd fds[2];
+	const char *slash = strrchr(debug_control.path, '/');
+	int watch = inotify_init1(IN_CLOEXEC);
+
+	(void)arg;
+	if (slash == NULL)
+		snprintf(dir, sizeof(dir), ".");
+	else
+		snprintf(dir, sizeof(dir), "%.*s", slash == debug_control.path ? 1 : (int)(slash - debug_control.path), debug_control.path);
+	if (watch >= 0 && inotify_add_watch(watch, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+	{
+		close(watch);
+		watch = -1;
+	}
+	fds[0].fd = debug_control.wake[0];
+	fds[0].events = POLLIN;
+	fds[1].fd = watch;
+	fds[1].events = POLLIN;
+	for (;;)
+	{
+		int changed = 0;
+		ssize_t n;
+
+		if (poll(fds, watch >= 0 ? 2 : 1, -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (fds[0].revents & POLLIN)
+			changed = read(debug_control.wake[0], events, sizeof(events)) > 0;
+		if (watch >= 0 && (fds[1].revents & POLLIN) && (n = read(watch, events, sizeof(events))) > 0)
+			for (char *p = events; p < events + n; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len)
+			{
+				const struct inotify_event *event = (const struct inotify_event *)p;
+
+				changed |= event->len != 0 && strcmp(event->name, debug_control.name) == 0;
+			}
+		if (changed)
+			debug_control_read();
+	}
+	return NULL;
+}
+
+/**
+ * @brief Read DEBUG_CONTROL_FILE=path: its content replaces DEBUG now, when it
+ * exists, and whenever it changes or SIGUSR1 is received
+ * @details From a dedicated thread: logging threads never wait for it.
+ */
+DEBUG_INTERNAL void debug_control_env(void)
+{
+	const char *path = getenv("DEBUG_CONTROL_FILE");
+	struct sigaction action;
+	const char *slash;
+
+	if (__atomic_exchange_n(&debug_control.configured, 1, __ATOMIC_ACQ_REL))
+		return;
+	if (path == NULL || path[0] == '\0')
+		return;
+	debug_control.path = strdup(path);
+	if (debug_control.path == NULL || pipe(debug_control.wake) != 0)
+	{
+		perror("DEBUG_CONTROL_FILE");
+		return;
+	}
+	for (int i = 0; i < 2; ++i)
+		fcntl(debug_control.wake[i], F_SETFD, FD_CLOEXEC);
+	fcntl(debug_control.wake[1], F_SETFL, O_NONBLOCK);
+	slash = strrchr(debug_control.path, '/');
+	debug_control.name = slash != NULL ? slash + 1 : debug_control.path;
+	debug_control_read();
+
+	if (pthread_create(&debug_control.thread, NULL, debug_control_main, NULL) != 0)
+	{
+		perror("DEBUG_CONTROL_FILE");
+		return;
+	}
+	pthread_detach(debug_control.thread);
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = debug_control_signal;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGUSR1, &action, NULL);
+}
+#endif // DEBUG_DEFINITIONS
+
+#endif // DEBUG_CONTROL_H
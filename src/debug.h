@@ -6,7 +6,7 @@
  * 
  * PROJECT:		DEBUG
  * 
- * MODIFIED:	Sat Dec 07 2024
+ * MODIFIED:	Sat Oct 17 2026
  * BY:			Dimitri Simon
  * 
  * Copyright (c) 2024 Dimitri Simon
@@ -43,10 +43,118 @@
 #define printf_debug(fmt, ...)
 #define printf_trace(fmt, ...)
 
+/**
+ * @brief printf_level, at most per_second records per second; the number
+ * dropped is told by the next record which passes
+ */
+#define printf_level_ratelimited(level, per_second, fmt, ...)
+/**
+ * @brief printf_level, one record out of n
+ */
+#define printf_level_every(level, n, fmt, ...)
+/**
+ * @brief printf_level, consecutive identical records collapsed into "last record repeated K times"
+ * @details Told when a different record comes.
+ */
+#define printf_level_dedup(level, fmt, ...)
+/**
+ * @brief printf_level with fields: a message, then DEBUG_KV(key, value)...
+ * @details One JSON or logfmt line with DEBUG_FORMAT, key=value after the message otherwise.
+ */
+#define printf_level_kv(level, message, ...)
+/**
+ * @brief Dump len bytes at data: offset, hexadecimal and ASCII columns
+ * @details Large buffers are cut in the middle, see DEBUG_HEX.
+ */
+#define printf_level_hex(level, data, len)
+
+#define printf_fatal_ratelimited(per_second, fmt, ...) printf_level_ratelimited(LOG_FATAL, per_second, fmt, ##__VA_ARGS__)
+#define printf_error_ratelimited(per_second, fmt, ...) printf_level_ratelimited(LOG_ERROR, per_second, fmt, ##__VA_ARGS__)
+#define printf_warning_ratelimited(per_second, fmt, ...) printf_level_ratelimited(LOG_WARNING, per_second, fmt, ##__VA_ARGS__)
+#define printf_info_ratelimited(per_second, fmt, ...) printf_level_ratelimited(LOG_INFO, per_second, fmt, ##__VA_ARGS__)
+#define printf_debug_ratelimited(per_second, fmt, ...) printf_level_ratelimited(LOG_DEBUG, per_second, fmt, ##__VA_ARGS__)
+#define printf_trace_ratelimited(per_second, fmt, ...) printf_level_ratelimited(LOG_TRACE, per_second, fmt, ##__VA_ARGS__)
+
+#define printf_fatal_every(n, fmt, ...) printf_level_every(LOG_FATAL, n, fmt, ##__VA_ARGS__)
+#define printf_error_every(n, fmt, ...) printf_level_every(LOG_ERROR, n, fmt, ##__VA_ARGS__)
+#define printf_warning_every(n, fmt, ...) printf_level_every(LOG_WARNING, n, fmt, ##__VA_ARGS__)
+#define printf_info_every(n, fmt, ...) printf_level_every(LOG_INFO, n, fmt, ##__VA_ARGS__)
+#define printf_debug_every(n, fmt, ...) printf_level_every(LOG_DEBUG, n, fmt, ##__VA_ARGS__)
+#define printf_trace_every(n, fmt, ...) printf_level_every(LOG_TRACE, n, fmt, ##__VA_ARGS__)
+
+#define printf_fatal_dedup(fmt, ...) printf_level_dedup(LOG_FATAL, fmt, ##__VA_ARGS__)
+#define printf_error_dedup(fmt, ...) printf_level_dedup(LOG_ERROR, fmt, ##__VA_ARGS__)
+#define printf_warning_dedup(fmt, ...) printf_level_dedup(LOG_WARNING, fmt, ##__VA_ARGS__)
+#define printf_info_dedup(fmt, ...) printf_level_dedup(LOG_INFO, fmt, ##__VA_ARGS__)
+#define printf_debug_dedup(fmt, ...) printf_level_dedup(LOG_DEBUG, fmt, ##__VA_ARGS__)
+#define printf_trace_dedup(fmt, ...) printf_level_dedup(LOG_TRACE, fmt, ##__VA_ARGS__)
+
+#define printf_fatal_kv(message, ...) printf_level_kv(LOG_FATAL, message, __VA_ARGS__)
+#define printf_error_kv(message, ...) printf_level_kv(LOG_ERROR, message, __VA_ARGS__)
+#define printf_warning_kv(message, ...) printf_level_kv(LOG_WARNING, message, __VA_ARGS__)
+#define printf_info_kv(message, ...) printf_level_kv(LOG_INFO, message, __VA_ARGS__)
+#define printf_debug_kv(message, ...) printf_level_kv(LOG_DEBUG, message, __VA_ARGS__)
+#define printf_trace_kv(message, ...) printf_level_kv(LOG_TRACE, message, __VA_ARGS__)
+
+#define printf_fatal_hex(data, len) printf_level_hex(LOG_FATAL, data, len)
+#define printf_error_hex(data, len) printf_level_hex(LOG_ERROR, data, len)
+#define printf_warning_hex(data, len) printf_level_hex(LOG_WARNING, data, len)
+#define printf_info_hex(data, len) printf_level_hex(LOG_INFO, data, len)
+#define printf_debug_hex(data, len) printf_level_hex(LOG_DEBUG, data, len)
+#define printf_trace_hex(data, len) printf_level_hex(LOG_TRACE, data, len)
+
+/**
+ * @brief Time the statements between DEBUG_TIMER_BEGIN(name) and DEBUG_TIMER_END(name)
+ * @details Each duration goes into a histogram of the call site, nothing is
+ * printed then: the percentiles are, at exit or by debug_timers_report().
+ * @param name An identifier, unique in its scope
+ */
+#define DEBUG_TIMER_BEGIN(name)
+#define DEBUG_TIMER_END(name)
+#define debug_timers_report()
+
+/**
+ * @brief Print the costliest statements now, see DEBUG_PROFILE
+ */
+#define debug_profile_report()
+
+/**
+ * @brief Print every statement of the program, reached or not: level, state, location
+ */
+#define debug_sites_list()
+
+/**
+ * @brief Replace DEBUG at runtime, same grammar; see also DEBUG_CONTROL_FILE
+ */
+#define debug_set_filter(filter)
+
+/**
+ * @brief Write records from a dedicated thread (see DEBUG_ASYNC)
+ * @param policy DEBUG_OVERFLOW_BLOCK, DEBUG_OVERFLOW_DROP_NEWEST or DEBUG_OVERFLOW_DROP_OLDEST
+ */
+#define debug_async_start(policy) 0
+#define debug_async_flush()
+#define debug_async_stop()
+
+/**
+ * @brief Send the records up to a level to a sink (see sink.h), instead of DEBUG_OUT
+ * @return The sink, NULL on failure
+ */
+#define debug_sink_fd(fd, level) NULL
+#define debug_sink_file(path, level) NULL
+#define debug_sink_rotate(path, level, max_size, period, keep) NULL
+#define debug_sink_memory(size, level) NULL
+#define debug_sink_memory_read(sink, buf, size) 0
+#define debug_sink_memory_clear(sink)
+#define debug_sink_remove(sink)
+#define debug_sinks_flush()
+
 #define C(x) (x + '0')
 
+#ifdef __clang__
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wformat"
+#endif // __clang__
 
 #if (defined(DEBUG) || defined(DEBUG_LEVEL))
 
@@ -59,198 +167,689 @@
 #undef dbg_printf
 #undef printf_custom
 #undef printf_level
+#undef debug_async_start
+#undef debug_async_flush
+#undef debug_async_stop
+#undef debug_sink_fd
+#undef debug_sink_file
+#undef debug_sink_rotate
+#undef debug_sink_memory
+#undef debug_sink_memory_read
+#undef debug_sink_memory_clear
+#undef debug_sink_remove
+#undef debug_sinks_flush
+#undef DEBUG_TIMER_BEGIN
+#undef DEBUG_TIMER_END
+#undef debug_timers_report
+#undef debug_profile_report
+#undef debug_sites_list
+#undef debug_set_filter
 
 #define __line__ STRINGIFY(__LINE__)
 
+/** Prefix of a record: file, function, line */
 #define FORMAT         \
 	T_OUT(T_FG_YELLOW) \
-	"%-" STRINGIFY(DEBUG_SPACING_FILE) "s" T_RESET " " T_OUT(T_BOLD T_FG_WHITE) "%-" STRINGIFY(DEBUG_SPACING_FUNCTION) "s" T_OUT("0;" T_FG_CYAN) "%+" STRINGIFY(DEBUG_SPACING_LINE) "u" T_RESET " "
+	"%-" STRINGIFY(DEBUG_SPACING_FILE) "s" T_RESET " " T_OUT(T_BOLD T_FG_WHITE) "%-" STRINGIFY(DEBUG_SPACING_FUNCTION) "s" T_OUT("0;" T_FG_CYAN) "%" STRINGIFY(DEBUG_SPACING_LINE) "u" T_RESET " "
+#define FORMAT_PLAIN \
+	"%-" STRINGIFY(DEBUG_SPACING_FILE) "s %-" STRINGIFY(DEBUG_SPACING_FUNCTION) "s%" STRINGIFY(DEBUG_SPACING_LINE) "u "
 
-#define __dbg_printf(format, ...) \
-	fprintf(DEBUG_OUT == 2 ? stderr : stdout, FORMAT format "\n", __FILE__, __func__, __LINE__, ##__VA_ARGS__)
+#ifndef DEBUG_RECORD_SIZE
+#define DEBUG_RECORD_SIZE 1024
+#endif // DEBUG_RECORD_SIZE
 
-#define dbg_printf(format, ...) \
-	fprintf(DEBUG_OUT == 2 ? stderr : stdout, "        " FORMAT format "\n", __FILE__, __func__, __LINE__, ##__VA_ARGS__)
+#ifndef DEBUG_HEX_BUFFER
+#define DEBUG_HEX_BUFFER 8192 // Larger dumps are allocated
+#endif // DEBUG_HEX_BUFFER
 
-#define printf_custom(file, func, line, level, format, ...)                                             \
-	{                                                                                                   \
-		__level(level);                                                                                 \
-		fprintf(DEBUG_OUT == 2 ? stderr : stdout, FORMAT format "\n", file, func, line, ##__VA_ARGS__); \
-	}
+#include <stdarg.h>
+#include <string.h>
 
-#define __level(level)                                                                                     \
-	{                                                                                                      \
-		switch (level)                                                                                     \
-		{                                                                                                  \
-		case LOG_DEBUG:                                                                                    \
-			fprintf(DEBUG_OUT == 2 ? stderr : stdout, T_OUT(T_BOLD T_FG_WHITE) " %-5s ", "DEBUG");         \
-			break;                                                                                         \
-		case LOG_INFO:                                                                                     \
-			fprintf(DEBUG_OUT == 2 ? stderr : stdout, T_OUT(T_BOLD T_FG_CYAN) " %-5s ", "INFO");           \
-			break;                                                                                         \
-		case LOG_WARNING:                                                                                  \
-			fprintf(DEBUG_OUT == 2 ? stderr : stdout, T_OUT(T_BOLD T_FG_YELLOW) " %-5s ", "WARN");         \
-			break;                                                                                         \
-		case LOG_ERROR:                                                                                    \
-			fprintf(DEBUG_OUT == 2 ? stderr : stdout, T_OUT(T_BOLD T_FG_RED) " %-5s ", "ERROR");           \
-			break;                                                                                         \
-		case LOG_FATAL:                                                                                    \
-			fprintf(DEBUG_OUT == 2 ? stderr : stdout, T_OUT(T_REVERSE T_BOLD T_FG_RED) " %-5s ", "FATAL"); \
-			break;                                                                                         \
-		default:                                                                                           \
-			fprintf(DEBUG_OUT == 2 ? stderr : stdout, T_OUT(T_REVERSE T_FG_WHITE) " %-5s ", "TRACE");      \
-			break;                                                                                         \
-		}                                                                                                  \
-		fprintf(DEBUG_OUT == 2 ? stderr : stdout, T_RESET " ");                                            \
-	}
+#include "limit.h"
+#include "output.h"
+#include "timer.h"
 
-#ifdef DEBUG_LEVEL
-#define printf_level(level, str, ...)         \
-	{                                         \
-		if (level <= DEBUG_LEVEL)             \
-		{                                     \
-			__level(level);                   \
-			__dbg_printf(str, ##__VA_ARGS__); \
-		}                                     \
+#if DEBUG_DEFINITIONS
+/**
+ * @brief Output a record as a JSON or logfmt line, see DEBUG_FORMAT
+ * @param message Cut at DEBUG_RECORD_SIZE
+ * @param kv Fields after the message
+ */
+DEBUG_INTERNAL void debug_structured_write(int fd, int level, const char *file, const char *func, unsigned line, const char *message, size_t len, const struct debug_kv *kv, unsigned count)
+{
+	char record[2 * DEBUG_RECORD_SIZE];
+	struct debug_writer w;
+
+	debug_writer_init(&w, record, sizeof(record), debug_format.mode);
+	debug_writer_head(&w, level, file, func, line);
+	debug_writer_key(&w, "msg");
+	debug_writer_quoted(&w, message, len);
+	for (unsigned i = 0; i < count; ++i)
+		debug_writer_kv(&w, &kv[i]);
+	debug_writer_end(&w);
+	debug_output(fd, level, record, w.p - record);
+}
+
+/**
+ * @brief debug_vprintf() in structured mode
+ * @param format Of the statement alone, ap starts with the file, function and line
+ */
+DEBUG_INTERNAL void debug_structured_vprintf(int fd, int level, const char *format, va_list ap)
+{
+	char message[DEBUG_RECORD_SIZE];
+	const char *file = va_arg(ap, const char *);
+	const char *func = va_arg(ap, const char *);
+	unsigned line = va_arg(ap, int);
+	int len = vsnprintf(message, sizeof(message), format, ap);
+
+	len = len < 0 ? 0 : (size_t)len >= sizeof(message) ? (int)sizeof(message) - 1 : len;
+	if (len > 0 && message[len - 1] == '\n')
+		--len;
+	debug_structured_write(fd, level, file, func, line, message, len, NULL, 0);
+}
+
+/**
+ * @brief Format a whole record, then output it at once
+ * @details In structured mode, the FORMAT prefix of the statements is replaced by fields.
+ * @param fd
+ * @param level loglevel, LOG_UNDEFINED for no tag
+ * @param color Format of the record after FORMAT, ap starts with the file, function and line
+ * @param plain The same after FORMAT_PLAIN
+ * @param ap Parameters for format
+ */
+DEBUG_INTERNAL void debug_vprintf(int fd, int level, const char *color, const char *plain, va_list ap)
+{
+	char buf[DEBUG_PREFIX_SIZE + DEBUG_RECORD_SIZE];
+	char *record = buf;
+	const int colored = debug_color(fd);
+	const char *tag = debug_tag(level, colored);
+	const char *format = colored ? color : plain;
+	size_t head;
+	va_list again;
+	int len;
+
+	if (!debug_sinks_accept(level))
+		return;
+	if (debug_structured())
+		return debug_structured_vprintf(fd, level, plain + sizeof(FORMAT_PLAIN) - 1, ap);
+	head = debug_stamp_write(buf);
+	memcpy(buf + head, tag, strlen(tag));
+	head += strlen(tag);
+	va_copy(again, ap);
+	len = vsnprintf(buf + head, sizeof(buf) - head, format, ap);
+	if (len >= 0 && (size_t)len >= sizeof(buf) - head)
+	{
+		record = (char *)malloc(head + len + 1);
+		if (record == NULL)
+		{
+			record = buf;
+			len = sizeof(buf) - head - 1;
+		}
+		else
+		{
+			memcpy(record, buf, head);
+			vsnprintf(record + head, len + 1, format, again);
+		}
 	}
-#else
+	va_end(again);
+	if (len < 0)
+		return;
+	debug_output(fd, level, record, head + len);
+	if (record != buf)
+		free(record);
+}
 
-#include <string.h>
-#include <regex.h>
-#include <assert.h>
+/**
+ * @brief Format a whole record, then output it at once
+ * @param fd
+ * @param level loglevel, LOG_UNDEFINED for no tag
+ * @param color Format of the record after FORMAT, ... starts with the file, function and line
+ * @param plain The same after FORMAT_PLAIN
+ */
+DEBUG_INTERNAL __attribute__((format(printf, 3, 5))) void debug_printf(int fd, int level, const char *color, const char *plain, ...)
+{
+	va_list ap;
 
-char *str_replace(char *orig, const char *rep, const char *with)
+	va_start(ap, plain);
+	debug_vprintf(fd, level, color, plain, ap);
+	va_end(ap);
+}
+
+/**
+ * @brief Output a statement as binary, or as text, and keep it in the flight recorder
+ * @param site
+ * @param state Of the site: DEBUG_SITE_ON, DEBUG_SITE_RECORD or both
+ * @param color Format of the text record after FORMAT, ap starts with the file, function and line
+ * @param plain The same after FORMAT_PLAIN
+ * @param ap Parameters for format
+ */
+DEBUG_INTERNAL void debug_site_vprintf(struct debug_site *site, unsigned char state, const char *color, const char *plain, va_list ap)
 {
-	char *result;  // the return string
-	char *ins;	   // the next insert point
-	char *tmp;	   // varies
-	int len_rep;   // length of rep (the string to remove)
-	int len_with;  // length of with (the string to replace rep with)
-	int len_front; // distance between rep and end of last rep
-	int count;	   // number of replacements
-
-	// sanity checks and initialization
-	if (!orig || !rep)
-		return NULL;
-	len_rep = strlen(rep);
-	if (len_rep == 0)
-		return NULL; // empty rep causes infinite loop during count
-	if (!with)
-		with = "";
-	len_with = strlen(with);
-
-	// count the number of replacements needed
-	ins = orig;
-	for (count = 0; tmp = strstr(ins, rep); ++count)
+	unsigned id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE);
+	va_list args;
+
+	if (__builtin_expect(id == 0, 0))
+		id = debug_binary_define(&site->id, site->level, DEBUG_KIND_C, site->file, site->func, site->line, site->format, site->args, &site->nargs);
+	if ((state & DEBUG_SITE_ON) && !debug_binary_on())
 	{
-		ins = tmp + len_rep;
+		va_copy(args, ap);
+		debug_vprintf(DEBUG_OUT, site->level, color, plain, args);
+		va_end(args);
 	}
+	// The parameters of the format of the site follow
+	(void)va_arg(ap, const char *);
+	(void)va_arg(ap, const char *);
+	(void)va_arg(ap, int);
+	if (state & DEBUG_SITE_RECORD)
+	{
+		va_copy(args, ap);
+		debug_recorder_vprintf(id, site->args, site->nargs, args);
+		va_end(args);
+	}
+	if ((state & DEBUG_SITE_ON) && debug_binary_on())
+		debug_binary_vprintf(id, site->args, site->nargs, ap);
+}
+
+/**
+ * @brief See debug_site_vprintf()
+ */
+DEBUG_INTERNAL void debug_site_printf(struct debug_site *site, unsigned char state, const char *color, const char *plain, ...)
+{
+	va_list ap;
+
+	va_start(ap, plain);
+	debug_site_vprintf(site, state, color, plain, ap);
+	va_end(ap);
+}
+
+/**
+ * @brief Tell how many records of a site its policy dropped
+ * @param repeated Identical to the last one, or over the rate limit
+ */
+DEBUG_INTERNAL void debug_site_report(const struct debug_site *site, int repeated, unsigned count)
+{
+	if (repeated)
+		debug_printf(DEBUG_OUT, site->level, FORMAT "last record repeated %u times\n", FORMAT_PLAIN "last record repeated %u times\n", site->file, site->func, site->line, count);
+	else
+		debug_printf(DEBUG_OUT, site->level, FORMAT "%u records over the rate limit\n", FORMAT_PLAIN "%u records over the rate limit\n", site->file, site->func, site->line, count);
+}
 
-	tmp = result = (char *)malloc(strlen(orig) + (len_with - len_rep) * count + 1);
+/**
+ * @brief Rate limit of a site, reporting the records dropped once one passes
+ */
+DEBUG_INTERNAL int debug_site_rate(const struct debug_site *site, struct debug_limit *limit, unsigned per_second)
+{
+	unsigned dropped;
 
-	if (!result)
-		return NULL;
+	if (!debug_limit_rate(limit, per_second, &dropped))
+		return 0;
+	if (dropped != 0)
+		debug_site_report(site, 0, dropped);
+	return 1;
+}
 
-	// first time through the loop, all the variable are set correctly
-	// from here on,
-	//    tmp points to the end of the result string
-	//    ins points to the next occurrence of rep in orig
-	//    orig points to the remainder of orig after "end of rep"
-	while (count--)
+/**
+ * @brief Output a statement unless it repeats the last one of the site
+ * @details The message is formatted to be compared; what repeats is still recorded.
+ * @param color Format of the text record after FORMAT, ... starts with the file, function and line
+ * @param plain The same after FORMAT_PLAIN
+ */
+DEBUG_INTERNAL void debug_site_dedup(struct debug_site *site, struct debug_limit *limit, unsigned char state, const char *color, const char *plain, ...)
+{
+	char message[DEBUG_RECORD_SIZE];
+	unsigned repeats;
+	va_list ap;
+	va_list args;
+	int len;
+
+	va_start(ap, plain);
+	if (state & DEBUG_SITE_ON)
 	{
-		ins = strstr(orig, rep);
-		len_front = ins - orig;
-		tmp = strncpy(tmp, orig, len_front) + len_front;
-		tmp = strcpy(tmp, with) + len_with;
-		orig += len_front + len_rep; // move to next "end of rep"
+		va_copy(args, ap);
+		(void)va_arg(args, const char *);
+		(void)va_arg(args, const char *);
+		(void)va_arg(args, int);
+		len = vsnprintf(message, sizeof(message), site->format, args);
+		va_end(args);
+		len = len < 0 ? 0 : (size_t)len >= sizeof(message) ? (int)sizeof(message) - 1 : len;
+		if (!debug_limit_repeat(limit, debug_limit_hash(message, len), &repeats))
+			state &= ~DEBUG_SITE_ON;
+		else if (repeats != 0)
+			debug_site_report(site, 1, repeats);
 	}
-	strcpy(tmp, orig);
-	strcpy(orig, result);
-	free(result);
+	if (state & (DEBUG_SITE_ON | DEBUG_SITE_RECORD))
+		debug_site_vprintf(site, state, color, plain, ap);
+	va_end(ap);
+}
 
-	return orig;
+/**
+ * @brief Output a statement with fields
+ * @details As text, the fields follow the message as key=value. The site
+ * keeps "%s" as format, for the binary output and the flight recorder.
+ */
+DEBUG_INTERNAL void debug_site_kv(struct debug_site *site, unsigned char state, const char *message, const struct debug_kv *kv, unsigned count)
+{
+	char text[DEBUG_RECORD_SIZE];
+	struct debug_writer w;
+
+	if ((state & DEBUG_SITE_ON) && debug_structured() && !debug_binary_on())
+	{
+		if (debug_sinks_accept(site->level))
+			debug_structured_write(DEBUG_OUT, site->level, site->file, site->func, site->line, message, strlen(message), kv, count);
+		state &= ~DEBUG_SITE_ON;
+	}
+	if (!(state & (DEBUG_SITE_ON | DEBUG_SITE_RECORD)))
+		return;
+	debug_writer_init(&w, text, sizeof(text) - 1, DEBUG_FORMAT_LOGFMT);
+	debug_writer_raw(&w, message, strlen(message));
+	w.fields = 1;
+	for (unsigned i = 0; i < count; ++i)
+		debug_writer_kv(&w, &kv[i]);
+	*w.p = '\0';
+	debug_site_printf(site, state, FORMAT "%s\n", FORMAT_PLAIN "%s\n", site->file, site->func, site->line, text);
 }
 
-#define BUF_SZ 8000
+DEBUG_INTERNAL struct debug_kv debug_kv_int(const char *key, long long v)
+{
+	struct debug_kv kv = {key, DEBUG_ARG_I64, {0}};
 
-int make_regex(char *regex, const char *buf)
+	kv.v.i = v;
+	return kv;
+}
+
+DEBUG_INTERNAL struct debug_kv debug_kv_uint(const char *key, unsigned long long v)
 {
-	char search[BUF_SZ] = "(.*)";
-	char level = C(LOG_TRACE);
+	struct debug_kv kv = {key, DEBUG_ARG_U64, {0}};
 
-#define GET_LEVEL(c)                                          \
-	if (c == '*' || (c >= C(LOG_FATAL) && c <= C(LOG_TRACE))) \
-		level = c == '*' ? C(LOG_TRACE) : c;
+	kv.v.u = v;
+	return kv;
+}
+
+DEBUG_INTERNAL struct debug_kv debug_kv_double(const char *key, double v)
+{
+	struct debug_kv kv = {key, DEBUG_ARG_DOUBLE, {0}};
 
-	if (buf[1] == ':')
+	kv.v.d = v;
+	return kv;
+}
+
+DEBUG_INTERNAL struct debug_kv debug_kv_string(const char *key, const char *v)
+{
+	struct debug_kv kv = {key, DEBUG_ARG_STRING, {0}};
+
+	kv.v.s = v;
+	return kv;
+}
+
+DEBUG_INTERNAL struct debug_kv debug_kv_bool(const char *key, int v)
+{
+	struct debug_kv kv = {key, DEBUG_ARG_BOOL, {0}};
+
+	kv.v.i = v;
+	return kv;
+}
+#else
+DEBUG_INTERNAL void debug_structured_write(int fd, int level, const char *file, const char *func, unsigned line, const char *message, size_t len, const struct debug_kv *kv, unsigned count);
+DEBUG_INTERNAL void debug_vprintf(int fd, int level, const char *color, const char *plain, va_list ap);
+DEBUG_INTERNAL __attribute__((format(printf, 3, 5))) void debug_printf(int fd, int level, const char *color, const char *plain, ...);
+DEBUG_INTERNAL void debug_site_vprintf(struct debug_site *site, unsigned char state, const char *color, const char *plain, va_list ap);
+DEBUG_INTERNAL void debug_site_printf(struct debug_site *site, unsigned char state, const char *color, const char *plain, ...);
+DEBUG_INTERNAL int debug_site_rate(const struct debug_site *site, struct debug_limit *limit, unsigned per_second);
+DEBUG_INTERNAL void debug_site_dedup(struct debug_site *site, struct debug_limit *limit, unsigned char state, const char *color, const char *plain, ...);
+DEBUG_INTERNAL void debug_site_kv(struct debug_site *site, unsigned char state, const char *message, const struct debug_kv *kv, unsigned count);
+DEBUG_INTERNAL struct debug_kv debug_kv_int(const char *key, long long v);
+DEBUG_INTERNAL struct debug_kv debug_kv_uint(const char *key, unsigned long long v);
+DEBUG_INTERNAL struct debug_kv debug_kv_double(const char *key, double v);
+DEBUG_INTERNAL struct debug_kv debug_kv_string(const char *key, const char *v);
+DEBUG_INTERNAL struct debug_kv debug_kv_bool(const char *key, int v);
+#endif // DEBUG_DEFINITIONS
+
+#ifndef __cplusplus
+/**
+ * @brief A field of printf_level_kv(), typed after value
+ */
+#define DEBUG_KV(key, value)               \
+	_Generic((value),                      \
+		_Bool: debug_kv_bool,              \
+		float: debug_kv_double,            \
+		double: debug_kv_double,           \
+		long double: debug_kv_double,      \
+		char *: debug_kv_string,           \
+		const char *: debug_kv_string,     \
+		unsigned char: debug_kv_uint,      \
+		unsigned short: debug_kv_uint,     \
+		unsigned: debug_kv_uint,           \
+		unsigned long: debug_kv_uint,      \
+		unsigned long long: debug_kv_uint, \
+		default: debug_kv_int)(key, value)
+#endif // __cplusplus
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief A buffer dump as one record: "N bytes", then its lines
+ * @details Structured, the bytes are a "hex" field, cut as the head of the dump.
+ */
+DEBUG_INTERNAL void debug_hex_output(const struct debug_site *site, const void *data, size_t len)
+{
+	char buf[DEBUG_HEX_BUFFER];
+	char *record = buf;
+	const int color = debug_color(DEBUG_OUT);
+	const size_t max = debug_hex_tail(len) == len ? len : debug_hex.head;
+	const size_t size = debug_structured() ? 2 * DEBUG_RECORD_SIZE + 2 * max + 8 : DEBUG_PREFIX_SIZE + DEBUG_RECORD_SIZE + debug_hex_size(len) + 1;
+	const char *tag = debug_tag(site->level, color);
+	size_t n;
+
+	if (size > sizeof(buf) && (record = (char *)malloc(size)) == NULL)
+		return;
+	if (debug_structured())
 	{
-		snprintf(search, BUF_SZ, "%s", &buf[2]);
-		GET_LEVEL(buf[0])
-		else fprintf(stderr, "DEBUG: '%c' isn't recognised as a debugging level (max is " __STRINGIFY(LOG_TRACE) " = " STRINGIFY(LOG_TRACE) ")\n\n", buf[0]);
+		struct debug_writer w;
+		char summary[32];
+
+		debug_writer_init(&w, record, size, debug_format.mode);
+		debug_writer_head(&w, site->level, site->file, site->func, site->line);
+		debug_writer_key(&w, "msg");
+		debug_writer_quoted(&w, summary, snprintf(summary, sizeof(summary), "%zu bytes", len));
+		debug_writer_key(&w, "bytes");
+		debug_writer_uint(&w, len);
+		debug_writer_key(&w, "hex");
+		if ((size_t)(w.end - w.p) > 2 * max + 4)
+		{
+			*w.p++ = '"';
+			w.p += debug_hex_string(w.p, data, len, max);
+			*w.p++ = '"';
+		}
+		debug_writer_end(&w);
+		n = w.p - record;
 	}
 	else
-		GET_LEVEL(buf[0])
-	else if (buf[0] >= (C(LOG_TRACE) + 1) && buf[0] <= '9')
-		fprintf(stderr, "DEBUG: '%c' isn't recognised as a debugging level (max is " __STRINGIFY(LOG_TRACE) " = " STRINGIFY(LOG_TRACE) ")\n\n", buf[0]);
-	else strncpy(search, &buf[2], BUF_SZ);
+	{
+		int head;
+
+		n = debug_stamp_write(record);
+		memcpy(record + n, tag, strlen(tag));
+		n += strlen(tag);
+		head = snprintf(record + n, DEBUG_RECORD_SIZE, color ? FORMAT "%zu bytes" : FORMAT_PLAIN "%zu bytes", site->file, site->func, site->line, len);
+		n += head < 0 ? 0 : head >= DEBUG_RECORD_SIZE ? DEBUG_RECORD_SIZE - 1 : head;
+		n += debug_hex_lines(record + n, data, len);
+		record[n++] = '\n';
+	}
+	debug_output(DEBUG_OUT, site->level, record, n);
+	if (record != buf)
+		free(record);
+}
+
+/**
+ * @brief Output a buffer dump, see printf_level_hex()
+ * @details The binary output and the flight recorder keep "N bytes" and the
+ * first 64 bytes in hexadecimal.
+ */
+DEBUG_INTERNAL void debug_site_hex(struct debug_site *site, unsigned char state, const void *data, size_t len)
+{
+	char summary[32 + 2 * 64 + 3];
+	int n;
+
+	if ((state & DEBUG_SITE_ON) && !debug_binary_on())
+	{
+		if (debug_sinks_accept(site->level))
+			debug_hex_output(site, data, len);
+		state &= ~DEBUG_SITE_ON;
+	}
+	if (!(state & (DEBUG_SITE_ON | DEBUG_SITE_RECORD)))
+		return;
+	n = snprintf(summary, 32, "%zu bytes ", len);
+	debug_hex_string(summary + n, data, len, 64);
+	debug_site_printf(site, state, FORMAT "%s\n", FORMAT_PLAIN "%s\n", site->file, site->func, site->line, summary);
+}
+#else
+DEBUG_INTERNAL void debug_site_hex(struct debug_site *site, unsigned char state, const void *data, size_t len);
+#endif // DEBUG_DEFINITIONS
+
+/**
+ * @brief Print the summary of a timer, see DEBUG_TIMER_BEGIN()
+ * @details A record of DEBUG_TIMER_LEVEL, from the function of the timer.
+ */
+DEBUG_LOCAL void debug_timer_print(const struct debug_timer *timer)
+{
+	char message[DEBUG_RECORD_SIZE];
+	struct debug_kv kv[DEBUG_TIMER_FIELDS];
+	struct debug_timer_stats stats;
 
-	return sprintf(regex, "[" STRINGIFY(LOG_FATAL) "-%c]\\:%s", level, search);
+#ifdef DEBUG_LEVEL
+	if (DEBUG_TIMER_LEVEL > DEBUG_LEVEL)
+		return;
+#else
+	if (!(debug_site_verdict(DEBUG_TIMER_LEVEL, timer->file, timer->func) & DEBUG_SITE_ON))
+		return;
+#endif // DEBUG_LEVEL
+	if (!debug_sinks_accept(DEBUG_TIMER_LEVEL))
+		return;
+	debug_timer_summary(timer, &stats);
+	if (debug_structured())
+	{
+		debug_timer_fields(timer, &stats, kv);
+		debug_structured_write(DEBUG_OUT, DEBUG_TIMER_LEVEL, timer->file, timer->func, timer->line, "timer", 5, kv, DEBUG_TIMER_FIELDS);
+		return;
+	}
+	debug_timer_message(timer, &stats, message, sizeof(message));
+	debug_printf(DEBUG_OUT, DEBUG_TIMER_LEVEL, FORMAT "%s\n", FORMAT_PLAIN "%s\n", timer->file, timer->func, timer->line, message);
 }
 
-char debug_var[0xffff];
-
-#define printf_level(level, format, ...)                                                \
-	{                                                                                   \
-		char *__debug_var = getenv("DEBUG");                                            \
-		if (__debug_var != NULL && strlen(__debug_var) != 0)                            \
-		{                                                                               \
-			regex_t debug_regex;                                                        \
-			strcpy(debug_var, __debug_var);                                             \
-			if (strcmp(debug_var, "*") == 0)                                            \
-				debug_var[0] = '6';                                                     \
-			else                                                                        \
-			{                                                                           \
-				str_replace(debug_var, "*:", STRINGIFY(LOG_TRACE) ":");                 \
-				str_replace(debug_var, "*", "(.*)");                                    \
-			}                                                                           \
-			char strregex[8000] = "^(";                                                 \
-			char *p = strregex + 2;                                                     \
-			char *c = strtok(debug_var, ";");                                           \
-                                                                                        \
-			p += make_regex(p, debug_var);                                              \
-			for (c = strtok(NULL, ";"); c != NULL; c = strtok(NULL, ";"))               \
-			{                                                                           \
-				*p++ = '|';                                                             \
-				p += make_regex(p, c);                                                  \
-			}                                                                           \
-			*p++ = ')';                                                                 \
-			*p++ = '$';                                                                 \
-			assert(!regcomp(&debug_regex, strregex, REG_EXTENDED));                     \
-			int ret = regexec(&debug_regex, STRINGIFY(level) ":" __FILE__, 0, NULL, 0); \
-			if (ret != 0)                                                               \
-			{                                                                           \
-				char testft[400];                                                       \
-				sprintf(testft, STRINGIFY(level) ":%s", __func__);                      \
-				ret = regexec(&debug_regex, testft, 0, NULL, 0);                        \
-			}                                                                           \
-			switch (ret)                                                                \
-			{                                                                           \
-			case 0:                                                                     \
-				__level(level);                                                         \
-				__dbg_printf(format, ##__VA_ARGS__);                                    \
-				break;                                                                  \
-			case REG_NOMATCH:                                                           \
-				break;                                                                  \
-			default:                                                                    \
-			{                                                                           \
-				char msg[800];                                                          \
-				regerror(ret, &debug_regex, msg, sizeof(msg));                          \
-				fprintf(stderr, "Regex match failed: %s\n", msg);                       \
-				exit(1);                                                                \
-			}                                                                           \
-			}                                                                           \
-			regfree(&debug_regex);                                                      \
-		}                                                                               \
+/**
+ * @brief A statement which may pass: evaluated when unknown, then counted,
+ * output and/or recorded
+ * @details Out of line: the call site only checks the state of the statement.
+ * @param state Of the site, DEBUG_SITE_UNKNOWN the first time
+ * @param color Format of the record after FORMAT, ... starts with the file, function and line
+ * @param plain The same after FORMAT_PLAIN
+ */
+DEBUG_LOCAL DEBUG_COLD __attribute__((format(printf, 3, 5))) void debug_site_emit(struct debug_site *site, unsigned char state, const char *color, const char *plain, ...)
+{
+	struct debug_profile_call call = {0, 0};
+	va_list ap;
+
+	if (state == DEBUG_SITE_UNKNOWN)
+		state = debug_site_state(site);
+	if (state & DEBUG_SITE_PROFILE)
+		debug_profile_begin(&call);
+	if (state & (DEBUG_SITE_ON | DEBUG_SITE_RECORD))
+	{
+		va_start(ap, plain);
+		// Plain text output keeps its direct path
+		if (__builtin_expect(state == DEBUG_SITE_ON && !debug_binary_on(), 1))
+			debug_vprintf(DEBUG_OUT, site->level, color, plain, ap);
+		else
+			debug_site_vprintf(site, state, color, plain, ap);
+		va_end(ap);
+	}
+	if (call.start != 0)
+		debug_profile_end(&site->profile, site->level, site->file, site->func, site->line, &call);
+}
+
+#define DEBUG_TIMER_INIT(name) \
+	{__FILE__, __func__, __LINE__, name, debug_timer_print, NULL, 0, 0, {0}}
+
+#define DEBUG_TIMER_BEGIN(name)                                               \
+	static struct debug_timer __debug_timer_##name = DEBUG_TIMER_INIT(#name); \
+	const uint64_t __debug_timer_start_##name = debug_timer_now()
+
+#define DEBUG_TIMER_END(name) \
+	debug_timer_record(&__debug_timer_##name, debug_timer_now() - __debug_timer_start_##name)
+
+/** DEBUG_SITE_RECORD when the flight recorder is on, for sites without a cached state */
+#define __debug_recording() \
+	(debug_recorder_on() ? DEBUG_SITE_RECORD : 0)
+/** DEBUG_SITE_PROFILE when DEBUG_PROFILE is set, likewise */
+#define __debug_profiling() \
+	(debug_profile_on() ? DEBUG_SITE_PROFILE : 0)
+
+/**
+ * @brief Emit a statement which passed, counted when DEBUG_PROFILE is set
+ * @details Without DEBUG_SITE_PROFILE, only the check of the state remains.
+ */
+#define __debug_profiled(site, state, emit)                                                               \
+	{                                                                                                     \
+		struct debug_profile_call __debug_call = {0, 0};                                                  \
+		if (__builtin_expect((state) & DEBUG_SITE_PROFILE, 0))                                            \
+			debug_profile_begin(&__debug_call);                                                           \
+		if ((state) & (DEBUG_SITE_ON | DEBUG_SITE_RECORD))                                                \
+			emit;                                                                                         \
+		if (__builtin_expect(__debug_call.start != 0, 0))                                                 \
+			debug_profile_end(&site.profile, site.level, site.file, site.func, site.line, &__debug_call); \
+	}
+
+/**
+ * @brief Output a statement which may pass, see debug_site_emit()
+ * @details The colored and plain formats are both literals, the choice is made once per record.
+ */
+#define __debug_emit(site, state, format, ...) \
+	debug_site_emit(&site, state, FORMAT format "\n", FORMAT_PLAIN format "\n", __FILE__, __func__, __LINE__, ##__VA_ARGS__)
+
+#define dbg_printf(format, ...)                                                                       \
+	{                                                                                                 \
+		static struct debug_site __debug_site DEBUG_SITE_SECTION = DEBUG_SITE(LOG_UNDEFINED, format); \
+		__debug_emit(__debug_site, DEBUG_SITE_ON | __debug_recording(), format, ##__VA_ARGS__);       \
+	}
+
+#define printf_custom(file, func, line, level, format, ...) \
+	debug_printf(DEBUG_OUT, level, FORMAT format "\n", FORMAT_PLAIN format "\n", file, func, line, ##__VA_ARGS__)
+
+/**
+ * @brief Output a statement if check passes, record it anyway
+ * @details __debug_site, __debug_limit and __debug_state are those of the
+ * statement, counted by __debug_profiled() with its check.
+ */
+#define __debug_limit_emit(check, format, ...)                                                      \
+	{                                                                                               \
+		if ((__debug_state & DEBUG_SITE_ON) && !(check))                                            \
+			__debug_state &= ~DEBUG_SITE_ON;                                                        \
+		if (__debug_state & (DEBUG_SITE_ON | DEBUG_SITE_RECORD))                                    \
+			__debug_emit(__debug_site, __debug_state & ~DEBUG_SITE_PROFILE, format, ##__VA_ARGS__); \
+	}
+
+/**
+ * @brief Output a statement unless it repeats the last one, see debug_site_dedup()
+ */
+#define __debug_dedup_emit(check, format, ...)                                                                                                                         \
+	{                                                                                                                                                                  \
+		if (__debug_state & (DEBUG_SITE_ON | DEBUG_SITE_RECORD))                                                                                                       \
+			debug_site_dedup(&__debug_site, &__debug_limit, __debug_state, FORMAT format "\n", FORMAT_PLAIN format "\n", __FILE__, __func__, __LINE__, ##__VA_ARGS__); \
+	}
+
+/**
+ * @brief Output a statement with fields, see debug_site_kv()
+ */
+#define __debug_kv_emit(message, format, ...)                                                                                                                                       \
+	{                                                                                                                                                                               \
+		if (__debug_state & (DEBUG_SITE_ON | DEBUG_SITE_RECORD))                                                                                                                    \
+			debug_site_kv(&__debug_site, __debug_state, message, (const struct debug_kv[]){__VA_ARGS__}, sizeof((const struct debug_kv[]){__VA_ARGS__}) / sizeof(struct debug_kv)); \
+	}
+
+#undef printf_level_ratelimited
+#undef printf_level_every
+#undef printf_level_dedup
+#undef printf_level_kv
+#undef printf_level_hex
+
+#define printf_level_ratelimited(level, per_second, format, ...) \
+	__printf_limited(level, __debug_limit_emit, debug_site_rate(&__debug_site, &__debug_limit, per_second), format, ##__VA_ARGS__)
+#define printf_level_every(level, n, format, ...) \
+	__printf_limited(level, __debug_limit_emit, debug_limit_every(&__debug_limit, n), format, ##__VA_ARGS__)
+#define printf_level_dedup(level, format, ...) \
+	__printf_limited(level, __debug_dedup_emit, 1, format, ##__VA_ARGS__)
+#define printf_level_kv(level, message, ...) \
+	__printf_limited(level, __debug_kv_emit, message, "%s", __VA_ARGS__)
+#define printf_level_hex(level, data, len) \
+	__printf_hex(level, data, len)
+
+#ifdef DEBUG_LEVEL
+#define printf_level(level, str, ...)                                                                                  \
+	{                                                                                                                  \
+		if (level <= DEBUG_LEVEL)                                                                                      \
+		{                                                                                                              \
+			static struct debug_site __debug_site DEBUG_SITE_SECTION = DEBUG_SITE(level, str);                         \
+			__debug_emit(__debug_site, DEBUG_SITE_ON | __debug_recording() | __debug_profiling(), str, ##__VA_ARGS__); \
+		}                                                                                                              \
+	}
+
+/**
+ * @brief A statement with a policy
+ * @param emit __debug_limit_emit, __debug_dedup_emit or __debug_kv_emit
+ * @param check Of __debug_limit_emit
+ */
+#define __printf_limited(level, emit, check, format, ...)                                            \
+	{                                                                                                \
+		if (level <= DEBUG_LEVEL)                                                                    \
+		{                                                                                            \
+			static struct debug_site __debug_site DEBUG_SITE_SECTION = DEBUG_SITE(level, format);    \
+			static struct debug_limit __debug_limit __attribute__((unused));                         \
+			unsigned char __debug_state = DEBUG_SITE_ON | __debug_recording() | __debug_profiling(); \
+			__debug_profiled(__debug_site, __debug_state, emit(check, format, ##__VA_ARGS__));       \
+		}                                                                                            \
+	}
+
+/**
+ * @brief A buffer dump statement, see debug_site_hex()
+ * @details "%s" describes the summary the binary output keeps.
+ */
+#define __printf_hex(level, data, len)                                                                              \
+	{                                                                                                               \
+		if (level <= DEBUG_LEVEL)                                                                                   \
+		{                                                                                                           \
+			static struct debug_site __debug_site DEBUG_SITE_SECTION = DEBUG_SITE(level, "%s");                     \
+			unsigned char __debug_state = DEBUG_SITE_ON | __debug_recording() | __debug_profiling();                \
+			__debug_profiled(__debug_site, __debug_state, debug_site_hex(&__debug_site, __debug_state, data, len)); \
+		}                                                                                                           \
+	}
+#else
+
+/**
+ * @details DEBUG is parsed once, each call site remembers whether it passes
+ * until debug_set_filter() replaces it.
+ * A filtered out statement costs a single branch, the rest is out of line:
+ * with the flight recorder on, it is still recorded, with DEBUG_PROFILE,
+ * still counted.
+ */
+#define printf_level(level, format, ...)                                                      \
+	{                                                                                         \
+		static struct debug_site __debug_site DEBUG_SITE_SECTION = DEBUG_SITE(level, format); \
+		unsigned char __debug_state = __atomic_load_n(&__debug_site.state, __ATOMIC_RELAXED); \
+		if (__builtin_expect(__debug_state != DEBUG_SITE_OFF, 0))                             \
+			__debug_emit(__debug_site, __debug_state, format, ##__VA_ARGS__);                 \
+	}
+
+/**
+ * @brief A statement with a policy, checked once the statement passes DEBUG
+ * @param emit __debug_limit_emit, __debug_dedup_emit or __debug_kv_emit
+ * @param check Of __debug_limit_emit
+ */
+#define __printf_limited(level, emit, check, format, ...)                                      \
+	{                                                                                          \
+		static struct debug_site __debug_site DEBUG_SITE_SECTION = DEBUG_SITE(level, format);  \
+		static struct debug_limit __debug_limit __attribute__((unused));                       \
+		unsigned char __debug_state = __atomic_load_n(&__debug_site.state, __ATOMIC_RELAXED);  \
+		if (__builtin_expect(__debug_state != DEBUG_SITE_OFF, 0))                              \
+		{                                                                                      \
+			if (__debug_state == DEBUG_SITE_UNKNOWN)                                           \
+				__debug_state = debug_site_state(&__debug_site);                               \
+			__debug_profiled(__debug_site, __debug_state, emit(check, format, ##__VA_ARGS__)); \
+		}                                                                                      \
+	}
+
+/**
+ * @brief A buffer dump statement, checked once it passes DEBUG, see debug_site_hex()
+ * @details "%s" describes the summary the binary output keeps.
+ */
+#define __printf_hex(level, data, len)                                                                              \
+	{                                                                                                               \
+		static struct debug_site __debug_site DEBUG_SITE_SECTION = DEBUG_SITE(level, "%s");                         \
+		unsigned char __debug_state = __atomic_load_n(&__debug_site.state, __ATOMIC_RELAXED);                       \
+		if (__builtin_expect(__debug_state != DEBUG_SITE_OFF, 0))                                                   \
+		{                                                                                                           \
+			if (__debug_state == DEBUG_SITE_UNKNOWN)                                                                \
+				__debug_state = debug_site_state(&__debug_site);                                                    \
+			__debug_profiled(__debug_site, __debug_state, debug_site_hex(&__debug_site, __debug_state, data, len)); \
+		}                                                                                                           \
 	}
 
 #undef printf_fatal
@@ -6,16 +6,25 @@
  * 
  * PROJECT:		DEBUG
  * 
- * MODIFIED:	Sat Dec 07 2024
+ * MODIFIED:	Sat Oct 17 2026
  * BY:			Dimitri Simon
  * 
  * Copyright (c) 2024 Dimitri Simon
  * 
  *******************************************************************************/
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <source_location>
+#include <string>
+#include <string_view>
+#include <type_traits>
 
 #include "term.h"
 
@@ -27,259 +36,1973 @@
 
 #define DEBUG_SPACING_FUNCTION_CPP_ADD 6
 
+#ifndef DEBUG_SITES
+#define DEBUG_SITES 4096
+#endif // DEBUG_SITES
+
+#ifndef DEBUG_OUT
+#define DEBUG_OUT 1 // std::cout
+#endif // DEBUG_OUT
+
+#if (defined(DEBUG) || defined(DEBUG_LEVEL))
+#include <cstdio>
+#include <ranges>
+#include <unistd.h>
+
+// C linkage: with DEBUG_LIBRARY, those of libdebug
+extern "C"
+{
+#include "filter.h"
+#include "limit.h"
+#include "output.h"
+#include "timer.h"
+}
+#endif // (defined(DEBUG) || defined(DEBUG_LEVEL))
+
+struct debug_sink;
+
+/** Inlined even without optimization */
+#define DEBUG_ALWAYS_INLINE inline __attribute__((always_inline))
+
 namespace debug
 {
-#ifdef DEBUG
+	/**
+	 * @brief Highest level compiled in, see DEBUG_LEVEL
+	 * @details The levels above compile to nothing, the others are still filtered by DEBUG.
+	 */
+#ifdef DEBUG_LEVEL
+	inline constexpr int max_level = DEBUG_LEVEL;
+#else
+	inline constexpr int max_level = LOG_TRACE;
+#endif // DEBUG_LEVEL
+
+	/**
+	 * @brief Statement compiled out
+	 * @details Every member is inlined at any optimization level, nothing remains of it.
+	 */
+	class debug_none
+	{
+	public:
+		template <typename T>
+		DEBUG_ALWAYS_INLINE constexpr debug_none &operator<<(T &&)
+		{
+			return *this;
+		}
+		DEBUG_ALWAYS_INLINE constexpr debug_none &operator<<(std::ios_base &(*)(std::ios_base &))
+		{
+			return *this;
+		}
+		DEBUG_ALWAYS_INLINE constexpr debug_none &operator<<(std::ios &(*)(std::ios &))
+		{
+			return *this;
+		}
+		DEBUG_ALWAYS_INLINE constexpr debug_none &operator<<(std::ostream &(*)(std::ostream &))
+		{
+			return *this;
+		}
+		DEBUG_ALWAYS_INLINE constexpr debug_none &every(unsigned)
+		{
+			return *this;
+		}
+		DEBUG_ALWAYS_INLINE constexpr debug_none &ratelimit(unsigned)
+		{
+			return *this;
+		}
+		DEBUG_ALWAYS_INLINE constexpr debug_none &dedup()
+		{
+			return *this;
+		}
+		template <typename T>
+		DEBUG_ALWAYS_INLINE constexpr debug_none &kv(const char *, T &&)
+		{
+			return *this;
+		}
+		template <typename... T>
+		DEBUG_ALWAYS_INLINE constexpr debug_none &hex(T &&...)
+		{
+			return *this;
+		}
+	};
+
+	/**
+	 * @brief Reached while checking a format string, which is then not a constant expression
+	 * @details The compiler reports the call, the reason included.
+	 */
+	inline void format_error(const char *) {}
+
+	/**
+	 * @brief Format string of debug::log::info("took {} ms", ms), checked at compile time
+	 * @details Placeholders: {}, {:x} and {:X} for integers, {:.N} for floating
+	 * point numbers, {{ and }} for braces. One per argument. Also holds the
+	 * location of the statement.
+	 */
+	template <typename... Args>
+	class format_string
+	{
+		std::string_view text;
+		std::source_location where;
+
+		/**
+		 * @return 'i' for integers, 'f' for floating point numbers, 'o' otherwise
+		 */
+		template <typename T>
+		static consteval char kind()
+		{
+			using U = std::remove_cvref_t<T>;
+
+			if constexpr (std::is_same_v<U, bool> || std::is_same_v<U, char>)
+				return 'o';
+			else if constexpr (std::is_integral_v<U>)
+				return 'i';
+			else if constexpr (std::is_floating_point_v<U>)
+				return 'f';
+			else
+				return 'o';
+		}
+
+		static consteval void check_spec(std::string_view spec, char kind)
+		{
+			if (spec.empty())
+				return;
+			if (spec[0] != ':')
+				format_error("only {} and {:spec} are supported, not positional arguments");
+			spec.remove_prefix(1);
+			if (spec == "x" || spec == "X")
+			{
+				if (kind != 'i')
+					format_error("{:x} and {:X} are for integers");
+				return;
+			}
+			if (spec.size() < 2 || spec.size() > 3 || spec[0] != '.' || spec.find_first_not_of("0123456789", 1) != std::string_view::npos)
+				format_error("supported specs are x, X and .N");
+			if (kind != 'f')
+				format_error("{:.N} is for floating point numbers");
+		}
+
+		static consteval void check(std::string_view text)
+		{
+			constexpr char kinds[] = {kind<Args>()..., '\0'};
+			std::size_t arg = 0;
+
+			for (std::size_t i = 0; i < text.size(); ++i)
+			{
+				if (text[i] == '}')
+				{
+					if (i + 1 == text.size() || text[i + 1] != '}')
+						format_error("unmatched }, write }}");
+					++i;
+				}
+				else if (text[i] == '{')
+				{
+					if (i + 1 < text.size() && text[i + 1] == '{')
+					{
+						++i;
+						continue;
+					}
+					const std::size_t close = text.find('}', i);
+					if (close == std::string_view::npos)
+						format_error("unmatched {, write {{");
+					if (arg == sizeof...(Args))
+						format_error("more {} than arguments");
+					check_spec(text.substr(i + 1, close - i - 1), kinds[arg++]);
+					i = close;
+				}
+			}
+			if (arg != sizeof...(Args))
+				format_error("fewer {} than arguments");
+		}
+
+	public:
+		template <typename S>
+			requires std::is_convertible_v<const S &, std::string_view>
+		consteval format_string(const S &text, const std::source_location &where = std::source_location::current())
+			: text(text), where(where)
+		{
+			check(this->text);
+		}
+
+		constexpr std::string_view get() const
+		{
+			return this->text;
+		}
+		constexpr const std::source_location &location() const
+		{
+			return this->where;
+		}
+	};
+
+	/**
+	 * @brief Format string checked against Args, not deduced from it
+	 */
+	template <typename... Args>
+	using format = format_string<std::type_identity_t<Args>...>;
+
+	/**
+	 * @brief An operand computed only when its statement passes: [&] { return dump(obj); }
+	 * @details Without DEBUG, or above DEBUG_LEVEL, it is never called.
+	 */
+	template <typename F>
+	concept lazy = std::invocable<F &> && !std::is_void_v<std::invoke_result_t<F &>>;
+
+#if (defined(DEBUG) || defined(DEBUG_LEVEL))
+
+	/**
+	 * @brief Verdict of DEBUG for every call site met so far
+	 * @details Open addressing, keyed on the std::source_location of the statement.
+	 * Lock-free: a slot is claimed by a CAS on its key, the verdict is computed once.
+	 */
+	class site_registry
+	{
+	public:
+		struct entry
+		{
+			std::atomic<std::uint64_t> key{0};
+			std::atomic<unsigned> state{DEBUG_SITE_UNKNOWN};       // debug_filter_stamp | DEBUG_SITE_*
+			unsigned id = 0;                                       // Binary output, 0 until described
+			std::atomic<const std::string_view *> prefix[3] = {}; // Plain, colored and structured, built by the first record
+			debug_limit limit = {};                                // Of every(), ratelimit() and dedup()
+			std::atomic<debug_timer *> timer{nullptr};             // Of a scope_timer, allocated by the first one
+			unsigned profile = 0;                                  // Slot of DEBUG_PROFILE, 0 until counted
+			std::source_location location;                         // Of the statement, once described
+			int level = LOG_UNDEFINED;
+			std::atomic<bool> described{false};
+		};
+
+		/**
+		 * @brief Cache of one call site, see site_slot
+		 */
+		struct slot
+		{
+			std::atomic<unsigned> state{DEBUG_SITE_UNKNOWN}; // As entry::state
+			std::atomic<entry *> site{nullptr};              // NULL until met, or when the registry is full
+		};
+
+	private:
+		entry entries[DEBUG_SITES];
+
+		static std::uint64_t hash(const std::source_location &location, int level)
+		{
+			std::uint64_t h = reinterpret_cast<std::uintptr_t>(location.file_name());
+
+			h ^= (static_cast<std::uint64_t>(location.line()) << 32) | location.column();
+			h ^= reinterpret_cast<std::uintptr_t>(location.function_name()) << 17; // Each instantiation of a template
+			h ^= static_cast<std::uint64_t>(level + 2) * 0x9e3779b97f4a7c15ULL;
+			h ^= h >> 33;
+			h *= 0xff51afd7ed558ccdULL;
+			h ^= h >> 33;
+			h *= 0xc4ceb9fe1a85ec53ULL;
+			h ^= h >> 33;
+			return h | 1;
+		}
+
+		/**
+		 * @brief Keep the name only out of std::source_location::function_name()
+		 * @details "void ns::marvelous(int)" gives "ns::marvelous"
+		 */
+		static const char *short_name(const char *function, char *buf, std::size_t size)
+		{
+			const char *end = std::strstr(function, "operator()");
+			end = end != NULL ? end + sizeof("operator()") - 1 : std::strchr(function, '(');
+			if (end == NULL)
+				end = function + std::strlen(function);
+
+			const char *begin = end;
+			while (begin != function && begin[-1] != ' ')
+				--begin;
+
+			std::size_t len = std::min<std::size_t>(end - begin, size - 1);
+			std::memcpy(buf, begin, len);
+			buf[len] = '\0';
+			return buf;
+		}
+
+		/**
+		 * @brief Level, file, function and line fields, see debug_writer_site()
+		 */
+		static void build_fields(std::string &out, const std::source_location &location, int level)
+		{
+			char name[256];
+			char buf[1024];
+			debug_writer w;
+
+			debug_writer_init(&w, buf, sizeof(buf), debug_format.mode);
+			debug_writer_site(&w, level, location.file_name(), short_name(location.function_name(), name, sizeof(name)), location.line());
+			out.append(buf, w.p - buf);
+		}
+
+		/**
+		 * @brief Level tag, file, function and line, padded
+		 * @param kind prefix_plain, prefix_color or prefix_structured
+		 */
+		static void build_prefix(std::string &out, const std::source_location &location, int level, int kind)
+		{
+			if (kind == prefix_structured)
+				return build_fields(out, location, level);
+
+			const bool color = kind == prefix_color;
+			const char *file = location.file_name();
+			const char *function = location.function_name();
+			const std::string line = std::to_string(location.line());
+			const std::size_t file_len = std::strlen(file);
+			const std::size_t function_len = std::strlen(function);
+
+			out += debug_tag(level, color);
+			out += color ? T_OUT(T_FG_YELLOW) : "";
+			out.append(file, file_len);
+			if (file_len < DEBUG_SPACING_FILE)
+				out.append(DEBUG_SPACING_FILE - file_len, ' ');
+			out += color ? T_RESET " " T_OUT(T_BOLD T_FG_WHITE) : " ";
+			out.append(function, function_len);
+			if (function_len < DEBUG_SPACING_FUNCTION + DEBUG_SPACING_FUNCTION_CPP_ADD)
+				out.append(DEBUG_SPACING_FUNCTION + DEBUG_SPACING_FUNCTION_CPP_ADD - function_len, ' ');
+			out += color ? T_RESET " " T_OUT(T_FG_CYAN) : " ";
+			if (line.size() < DEBUG_SPACING_LINE)
+				out.append(DEBUG_SPACING_LINE - line.size(), ' ');
+			out += line;
+			out += color ? T_RESET " " : " ";
+		}
+
+		static unsigned char evaluate(const std::source_location &location, int level)
+		{
+			char name[256];
+
+			return debug_site_verdict(level, location.file_name(), short_name(location.function_name(), name, sizeof(name)));
+		}
+
+		static bool same(const entry &e, const std::source_location &location, int level)
+		{
+			return e.level == level && e.location.file_name() == location.file_name() && e.location.line() == location.line() && e.location.column() == location.column() && e.location.function_name() == location.function_name();
+		}
+
+	public:
+		static constexpr int prefix_plain = 0;
+		static constexpr int prefix_color = 1;
+		static constexpr int prefix_structured = 2; // Fields of DEBUG_FORMAT
+
+		/**
+		 * @brief Entry of the statement at location
+		 * @return NULL when the registry is full
+		 * @details An entry whose key collides is told apart by its location, function and level,
+		 * so each instantiation of a template has its own.
+		 */
+		entry *find(const std::source_location &location, int level)
+		{
+			const std::uint64_t h = hash(location, level);
+
+			for (std::size_t i = 0; i < DEBUG_SITES; ++i)
+			{
+				entry &e = entries[(h + i) % DEBUG_SITES];
+				std::uint64_t key = e.key.load(std::memory_order_acquire);
+
+				if (key == 0 && e.key.compare_exchange_strong(key, h, std::memory_order_acq_rel))
+				{
+					e.location = location;
+					e.level = level;
+					e.described.store(true, std::memory_order_release);
+					return &e;
+				}
+				if (key != h)
+					continue;
+				while (!e.described.load(std::memory_order_acquire))
+					sched_yield(); // Being claimed
+				if (same(e, location, level))
+					return &e;
+			}
+			return NULL;
+		}
+
+		/**
+		 * @brief Whether the statement passes DEBUG, evaluated once per entry
+		 * and generation of the filter, see debug_set_filter()
+		 * @return See debug_site_verdict()
+		 */
+		unsigned char state(entry *e, const std::source_location &location, int level)
+		{
+			if (e == NULL)
+				return evaluate(location, level);
+
+			unsigned word = e->state.load(std::memory_order_relaxed);
+			if ((word ^ __atomic_load_n(&debug_filter_stamp, __ATOMIC_RELAXED)) > DEBUG_SITE_MASK)
+			{
+				const unsigned stamp = __atomic_load_n(&debug_filter_stamp, __ATOMIC_ACQUIRE);
+
+				word = stamp | evaluate(location, level);
+				e->state.store(word, std::memory_order_relaxed);
+			}
+			return word & DEBUG_SITE_MASK;
+		}
+
+		/**
+		 * @brief state() of a call site, kept in its own slot
+		 * @details A load and a compare with debug_filter_stamp: the registry
+		 * is only looked up the first time, and when the filter changes.
+		 */
+		unsigned char state(slot &s, const std::source_location &location, int level)
+		{
+			const unsigned word = s.state.load(std::memory_order_acquire);
+
+			if (__builtin_expect((word ^ __atomic_load_n(&debug_filter_stamp, __ATOMIC_RELAXED)) > DEBUG_SITE_MASK, 0))
+				return this->refresh(s, location, level);
+			return word & DEBUG_SITE_MASK;
+		}
+
+		DEBUG_COLD unsigned char refresh(slot &s, const std::source_location &location, int level)
+		{
+			entry *e = s.site.load(std::memory_order_relaxed);
+
+			if (e == NULL)
+			{
+				e = this->find(location, level);
+				s.site.store(e, std::memory_order_relaxed);
+			}
+
+			const unsigned stamp = __atomic_load_n(&debug_filter_stamp, __ATOMIC_ACQUIRE);
+			const unsigned char verdict = this->state(e, location, level);
+
+			s.state.store(stamp | verdict, std::memory_order_release);
+			return verdict;
+		}
+
+		/**
+		 * @brief Prefix of the records of the statement
+		 * @details Built the first time, then shared by every record: the
+		 * loser of a concurrent build frees its copy.
+		 */
+		std::string_view prefix(entry *e, const std::source_location &location, int level, int kind)
+		{
+			if (e == NULL)
+			{
+				thread_local std::string scratch;
+
+				scratch.clear();
+				build_prefix(scratch, location, level, kind);
+				return scratch;
+			}
+
+			std::atomic<const std::string_view *> &cached = e->prefix[kind];
+			const std::string_view *prefix = cached.load(std::memory_order_acquire);
+			if (prefix != NULL)
+				return *prefix;
+
+			std::string built;
+			build_prefix(built, location, level, kind);
+			char *text = new char[built.size()];
+			std::memcpy(text, built.data(), built.size());
+
+			const std::string_view *fresh = new std::string_view(text, built.size());
+			if (!cached.compare_exchange_strong(prefix, fresh, std::memory_order_acq_rel))
+			{
+				delete[] text;
+				delete fresh;
+				return *prefix;
+			}
+			return *fresh;
+		}
+
+		/**
+		 * @brief Print every statement met so far, see debug_sites_list()
+		 */
+		void list()
+		{
+			char name[256];
+			char line[1024];
+
+			for (entry &e : this->entries)
+				if (e.described.load(std::memory_order_acquire))
+				{
+					const std::size_t n = debug_site_line(line, sizeof(line), e.level, e.location.file_name(), short_name(e.location.function_name(), name, sizeof(name)), e.location.line(), state(&e, e.location, e.level));
+
+					debug_output(DEBUG_OUT, LOG_UNDEFINED, line, n);
+				}
+		}
+
+		/**
+		 * @brief Binary id of the statement, described the first time
+		 */
+		unsigned id(entry *e, const std::source_location &location, int level)
+		{
+			unsigned none = 0;
+			unsigned *id = e != NULL ? &e->id : &none;
+			unsigned ret = __atomic_load_n(id, __ATOMIC_ACQUIRE);
+
+			if (ret == 0)
+				ret = debug_binary_define(id, level, DEBUG_KIND_CPP, location.file_name(), location.function_name(), location.line(), "", NULL, NULL);
+			return ret;
+		}
+	};
+
+	inline site_registry sites;
+
+	/**
+	 * @brief Slot of the call site of Tag
+	 * @details Tag is a lambda type defaulted at the call site, so that each
+	 * statement gets its own slot without a macro.
+	 */
+	template <typename Tag>
+	inline site_registry::slot site_slot;
+
+	/**
+	 * @brief Per thread buffer the records are formatted in
+	 * @details The std::ostream is built once per thread. A record is written
+	 * with a single write(2) when its statement ends, so lines of different
+	 * threads do not interleave. Records are stacked: a statement evaluated
+	 * while formatting another one is written first.
+	 */
+	class record_buffer : public std::streambuf
+	{
+		std::string data;
+
+	protected:
+		int_type overflow(int_type c) override
+		{
+			if (c != traits_type::eof())
+				this->data.push_back(traits_type::to_char_type(c));
+			return c;
+		}
+		std::streamsize xsputn(const char *s, std::streamsize n) override
+		{
+			this->data.append(s, n);
+			return n;
+		}
+
+	public:
+		std::ostream stream;
+
+		record_buffer() : stream(this)
+		{
+			this->data.reserve(1024);
+		}
+
+		/**
+		 * @return Where the record starts
+		 */
+		std::size_t begin()
+		{
+			return this->data.size();
+		}
+
+		const char *at(std::size_t pos) const
+		{
+			return this->data.data() + pos;
+		}
+
+		/**
+		 * @brief Append raw bytes, for binary records
+		 */
+		void put(const void *p, std::size_t n)
+		{
+			this->data.append(static_cast<const char *>(p), n);
+		}
+		void patch(std::size_t at, const void *p, std::size_t n)
+		{
+			std::memcpy(this->data.data() + at, p, n);
+		}
+
+		/**
+		 * @brief n bytes to write in place, see settle()
+		 */
+		char *room(std::size_t n)
+		{
+			const std::size_t at = this->data.size();
+
+			this->data.resize(at + n);
+			return this->data.data() + at;
+		}
+		/**
+		 * @brief Keep what was written in room() up to end
+		 */
+		void settle(const char *end)
+		{
+			this->data.resize(end - this->data.data());
+		}
+
+		/**
+		 * @brief Escape the text from pos on, for structured records
+		 */
+		void escape(std::size_t pos)
+		{
+			const std::size_t n = this->data.size() - pos;
+			const std::size_t extra = debug_escape_extra(this->data.data() + pos, n);
+
+			if (extra == 0)
+				return;
+			this->data.resize(this->data.size() + extra);
+			debug_escape_inplace(this->data.data() + pos, n, extra);
+		}
+
+		/**
+		 * @brief Terminate the record started at start and output it
+		 */
+		void end(std::size_t start, int fd, int level)
+		{
+			this->data.push_back('\n');
+			debug_output(fd, level, this->data.data() + start, this->data.size() - start);
+			this->data.resize(start);
+		}
+
+		/**
+		 * @brief Forget the record started at start
+		 */
+		void drop(std::size_t start)
+		{
+			this->data.resize(start);
+		}
+
+		/**
+		 * @brief Terminate the binary record started at start
+		 * @param output To the binary output
+		 * @param record To the flight recorder
+		 */
+		void end_binary(std::size_t start, bool output, bool record)
+		{
+			std::uint32_t size = this->data.size() - start - DEBUG_BINARY_HEADER;
+
+			this->patch(start + DEBUG_BINARY_HEADER - 4, &size, 4);
+			if (output)
+				debug_binary_write(this->data.data() + start, this->data.size() - start);
+			if (record)
+				debug_recorder_append(this->data.data() + start, this->data.size() - start);
+			this->data.resize(start);
+		}
+
+		/**
+		 * @brief Keep the text from message on in the flight recorder
+		 * @details As a binary record of a single string, cut at DEBUG_BINARY_STRING.
+		 */
+		void record(std::size_t message, unsigned id)
+		{
+			char record[DEBUG_BINARY_HEADER + 3 + DEBUG_BINARY_STRING];
+			const std::uint64_t now = debug_binary_now();
+			const std::uint16_t len = std::min<std::size_t>(this->data.size() - message, DEBUG_BINARY_STRING);
+			const std::uint32_t size = 3 + len;
+
+			record[0] = 'R';
+			std::memcpy(record + 1, &id, 4);
+			std::memcpy(record + 5, &now, 8);
+			std::memcpy(record + 13, &size, 4);
+			record[DEBUG_BINARY_HEADER] = DEBUG_ARG_STRING;
+			std::memcpy(record + DEBUG_BINARY_HEADER + 1, &len, 2);
+			std::memcpy(record + DEBUG_BINARY_HEADER + 3, this->data.data() + message, len);
+			debug_recorder_append(record, DEBUG_BINARY_HEADER + size);
+		}
+	};
+
+	inline thread_local record_buffer records;
+
+	/**
+	 * @brief A statement, from debug::cout() to the end of the expression
+	 */
+	class debug_log
+	{
+		struct format
+		{
+			std::ios_base::fmtflags flags;
+			std::streamsize precision;
+			char fill;
+		};
+
+		int fd;
+		int level;
+		bool need_pad = true;
+		bool binary = false;
+		site_registry::entry *site = NULL;
+		bool enabled;	// Output, as text or binary
+		bool recording; // To the flight recorder
+		bool unique = false; // See dedup()
+		bool structured = false; // See DEBUG_FORMAT
+		bool in_message = false; // Text since the last field, in structured records the msg string
+		std::size_t start = 0;
+		std::size_t message = 0; // After the prefix
+		format saved;
+		std::source_location location;
+		debug_profile_call profile = {0, 0}; // See DEBUG_PROFILE
+
+		/**
+		 * @brief Registry entry of the statement
+		 * @details Looked up the first time it is needed for debug::cout() and
+		 * debug::cerr(), NULL when the registry is full.
+		 */
+		site_registry::entry *entry()
+		{
+			if (this->site == NULL)
+				this->site = sites.find(this->location, this->level);
+			return this->site;
+		}
+
+		/**
+		 * @brief Binary record header, the values follow
+		 */
+		void pad_binary()
+		{
+			const unsigned id = sites.id(this->entry(), this->location, this->level);
+			const std::uint64_t now = debug_binary_now();
+			const std::uint32_t size = 0;
+
+			this->start = records.begin();
+			records.put("R", 1);
+			records.put(&id, 4);
+			records.put(&now, 8);
+			records.put(&size, 4);
+			this->binary = true;
+			this->need_pad = false;
+		}
+
+		template <typename T>
+		void encode(T &&value)
+		{
+			using U = std::remove_cvref_t<T>;
+			char type;
+
+			if constexpr (std::is_same_v<U, bool>)
+			{
+				const char v = value;
+				records.put(&(type = DEBUG_ARG_BOOL), 1);
+				records.put(&v, 1);
+			}
+			else if constexpr (std::is_same_v<U, char>)
+			{
+				records.put(&(type = DEBUG_ARG_CHAR), 1);
+				records.put(&value, 1);
+			}
+			else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>)
+			{
+				const long long v = value;
+				records.put(&(type = DEBUG_ARG_I64), 1);
+				records.put(&v, sizeof(v));
+			}
+			else if constexpr (std::is_integral_v<U>)
+			{
+				const unsigned long long v = value;
+				records.put(&(type = DEBUG_ARG_U64), 1);
+				records.put(&v, sizeof(v));
+			}
+			else if constexpr (std::is_same_v<U, long double>)
+			{
+				records.put(&(type = DEBUG_ARG_LDOUBLE), 1);
+				records.put(&value, sizeof(value));
+			}
+			else if constexpr (std::is_floating_point_v<U>)
+			{
+				const double v = value;
+				records.put(&(type = DEBUG_ARG_DOUBLE), 1);
+				records.put(&v, sizeof(v));
+			}
+			else if constexpr (std::is_convertible_v<T, std::string_view>)
+			{
+				const std::string_view v = value;
+				const std::uint16_t len = std::min<std::size_t>(v.size(), DEBUG_BINARY_STRING);
+				records.put(&(type = DEBUG_ARG_STRING), 1);
+				records.put(&len, 2);
+				records.put(v.data(), len);
+			}
+			else if constexpr (std::is_pointer_v<U>)
+			{
+				const void *v = value;
+				records.put(&(type = DEBUG_ARG_POINTER), 1);
+				records.put(&v, sizeof(v));
+			}
+			else
+			{
+				// Anything else is formatted now, and kept as a string
+				const std::uint16_t none = 0;
+				records.put(&(type = DEBUG_ARG_STRING), 1);
+				const std::size_t at = records.begin();
+				records.put(&none, 2);
+				records.stream << std::forward<T>(value);
+				const std::uint16_t len = std::min<std::size_t>(records.begin() - at - 2, DEBUG_BINARY_STRING);
+				records.patch(at, &len, 2);
+			}
+		}
+
+		/**
+		 * @brief Writer over n more bytes of the record, settled by the caller
+		 * @param fields Written so far, for the separators
+		 */
+		static debug_writer writer(std::size_t n, int mode, int fields)
+		{
+			debug_writer w;
+
+			debug_writer_init(&w, records.room(n + 2), n + 2, mode);
+			w.fields = fields;
+			return w;
+		}
+
+		/**
+		 * @brief Opening and fields of the statement of a structured record
+		 */
+		void fields()
+		{
+			debug_writer w = writer(DEBUG_FIELDS_OPEN, debug_format.mode, 0);
+
+			debug_writer_open(&w);
+			if (w.fields != 0)
+				debug_writer_raw(&w, debug_format.mode == DEBUG_FORMAT_JSON ? "," : " ", 1);
+			records.settle(w.p);
+			const std::string_view prefix = sites.prefix(this->site, this->location, this->level, site_registry::prefix_structured);
+			records.put(prefix.data(), prefix.size());
+		}
+
+		/**
+		 * @brief Open the msg field at the first text of a structured record
+		 * @details Elsewhere, text after a field is parted from it by a space.
+		 */
+		void open_message()
+		{
+			if (this->in_message)
+				return;
+			this->in_message = true;
+			if (this->structured)
+				records.put(debug_format.mode == DEBUG_FORMAT_JSON ? ",\"msg\":\"" : " msg=\"", debug_format.mode == DEBUG_FORMAT_JSON ? 8 : 6);
+			else if (this->binary)
+			{
+				if (records.begin() != this->start + DEBUG_BINARY_HEADER)
+					this->encode(std::string_view(" ", 1));
+			}
+			else if (records.begin() != this->message)
+				records.put(" ", 1);
+		}
+		void close_message()
+		{
+			if (!this->in_message)
+				return;
+			this->in_message = false;
+			if (this->structured)
+				records.put("\"", 1);
+		}
+
+		/**
+		 * @brief A field of a text record: " key=value", strings quoted when needed
+		 */
+		template <typename T>
+		void text_kv(const char *key, T &&value)
+		{
+			using U = std::remove_cvref_t<T>;
+
+			this->close_message();
+			if (records.begin() != this->message)
+				records.put(" ", 1);
+			records.put(key, std::strlen(key));
+			records.put("=", 1);
+			if constexpr (std::is_same_v<U, bool>)
+				records.put(value ? "true" : "false", value ? 4 : 5);
+			else if constexpr (std::is_convertible_v<T, std::string_view> && !std::is_same_v<U, char>)
+			{
+				const std::string_view v = value;
+				debug_writer w = writer(v.size() * 6 + 2, DEBUG_FORMAT_LOGFMT, 0);
+
+				debug_writer_string(&w, v.data(), v.size());
+				records.settle(w.p);
+			}
+			else
+				records.stream << std::forward<T>(value);
+		}
+
+		/**
+		 * @brief A field of a structured record, typed after value
+		 * @details Other types than numbers, booleans and strings are formatted, then escaped.
+		 */
+		template <typename T>
+		void structured_kv(const char *key, T &&value)
+		{
+			using U = std::remove_cvref_t<T>;
+			const int mode = debug_format.mode;
+
+			this->close_message();
+			debug_writer w = writer(std::strlen(key) * 6 + 48, mode, 1);
+			debug_writer_key(&w, key);
+			if constexpr (std::is_same_v<U, bool>)
+				debug_writer_bool(&w, value);
+			else if constexpr (std::is_integral_v<U> && !std::is_same_v<U, char> && std::is_signed_v<U>)
+				debug_writer_int(&w, value);
+			else if constexpr (std::is_integral_v<U> && !std::is_same_v<U, char>)
+				debug_writer_uint(&w, value);
+			else if constexpr (std::is_floating_point_v<U>)
+				debug_writer_double(&w, value);
+			else if constexpr (std::is_convertible_v<T, std::string_view> && !std::is_same_v<U, char>)
+			{
+				const std::string_view v = value;
+
+				records.settle(w.p);
+				w = writer(v.size() * 6 + 2, mode, 1);
+				debug_writer_string(&w, v.data(), v.size());
+			}
+			else
+			{
+				records.settle(w.p);
+				records.put("\"", 1);
+				const std::size_t from = records.begin();
+				records.stream << std::forward<T>(value);
+				records.escape(from);
+				records.put("\"", 1);
+				return;
+			}
+			records.settle(w.p);
+		}
+
+		/**
+		 * @brief Text of the message, as is
+		 */
+		void put_text(std::string_view text)
+		{
+			if (text.empty())
+				return;
+			this->open_message();
+			if (this->binary)
+				return this->encode(text);
+			if (this->structured)
+			{
+				const std::size_t from = records.begin();
+				records.put(text.data(), text.size());
+				records.escape(from);
+				return;
+			}
+			records.put(text.data(), text.size());
+		}
+
+		/**
+		 * @brief Characters of a number, which need no escaping
+		 */
+		void put_chars(const char *begin, const char *end)
+		{
+			this->open_message();
+			records.put(begin, end - begin);
+		}
+
+		/**
+		 * @brief Characters of a number, as a spec of format() asks
+		 * @return End of the characters, nullptr when they do not fit
+		 */
+		template <typename U>
+		static char *spec_chars(char *begin, char *end, U value, std::string_view spec)
+		{
+			if constexpr (std::is_integral_v<U>)
+			{
+				const std::to_chars_result r = std::to_chars(begin, end, value, spec.empty() ? 10 : 16);
+
+				if (r.ec != std::errc())
+					return nullptr;
+				if (spec == ":X")
+					std::transform(begin, r.ptr, begin, [](char c) { return c >= 'a' ? c - 'a' + 'A' : c; });
+				return r.ptr;
+			}
+			else
+			{
+				int precision = 0;
+
+				if (spec.empty())
+				{
+					const std::to_chars_result r = std::to_chars(begin, end, value);
+					return r.ec == std::errc() ? r.ptr : nullptr;
+				}
+				std::from_chars(spec.data() + 2, spec.data() + spec.size(), precision);
+				const std::to_chars_result r = std::to_chars(begin, end, value, std::chars_format::fixed, precision);
+				return r.ec == std::errc() ? r.ptr : nullptr;
+			}
+		}
+
+		/**
+		 * @brief A value of format(), as its spec asks
+		 * @details Numbers go through std::to_chars, types other than numbers,
+		 * strings and pointers through their operator<<.
+		 */
+		template <typename T>
+		void put_value(T &&value, std::string_view spec)
+		{
+			using U = std::remove_cvref_t<T>;
+
+			if (this->binary)
+			{
+				// The record keeps the plain number, so a spec is applied here
+				if constexpr (std::is_arithmetic_v<U> && !std::is_same_v<U, bool> && !std::is_same_v<U, char>)
+					if (!spec.empty())
+					{
+						char text[DEBUG_BINARY_STRING];
+
+						if (char *end = spec_chars(text, text + sizeof(text), value, spec))
+							return this->put_text(std::string_view(text, end - text));
+					}
+				this->open_message();
+				return this->encode(std::forward<T>(value));
+			}
+			if constexpr (std::is_same_v<U, bool>)
+				this->put_text(value ? "true" : "false");
+			else if constexpr (std::is_same_v<U, char>)
+				this->put_text(std::string_view(&value, 1));
+			else if constexpr (std::is_integral_v<U>)
+			{
+				char text[sizeof(U) * 8 + 1];
+
+				this->put_chars(text, spec_chars(text, text + sizeof(text), value, spec));
+			}
+			else if constexpr (std::is_floating_point_v<U>)
+			{
+				char text[64];
+
+				if (char *end = spec_chars(text, text + sizeof(text), value, spec))
+					return this->put_chars(text, end);
+				// Fixed notation of large numbers takes hundreds of digits
+				this->open_message();
+				for (std::size_t n = sizeof(text) * 8;; n *= 8)
+				{
+					char *p = records.room(n);
+					char *end = spec_chars(p, p + n, value, spec);
+
+					records.settle(end != nullptr ? end : p);
+					if (end != nullptr)
+						break;
+				}
+			}
+			else if constexpr (std::is_convertible_v<T, std::string_view>)
+				this->put_text(value);
+			else if constexpr (std::is_pointer_v<U>)
+			{
+				char text[2 + sizeof(void *) * 2] = {'0', 'x'};
+
+				this->put_chars(text, std::to_chars(text + 2, text + sizeof(text), reinterpret_cast<std::uintptr_t>(value), 16).ptr);
+			}
+			else if (this->structured)
+			{
+				this->open_message();
+				const std::size_t from = records.begin();
+				records.stream << std::forward<T>(value);
+				records.escape(from);
+			}
+			else
+			{
+				this->open_message();
+				records.stream << std::forward<T>(value);
+			}
+		}
+
+		/**
+		 * @brief Text of format up to its next placeholder, then value
+		 * @param format What is left of the format string, checked by format_string
+		 */
+		template <typename T>
+		void format_next(std::string_view &format, T &&value)
+		{
+			for (;;)
+			{
+				const std::size_t brace = format.find_first_of("{}");
+
+				this->put_text(format.substr(0, brace));
+				if (format[brace] == format[brace + 1]) // {{ or }}
+				{
+					this->put_text(format.substr(brace, 1));
+					format.remove_prefix(brace + 2);
+					continue;
+				}
+				const std::size_t close = format.find('}', brace);
+				this->put_value(std::forward<T>(value), format.substr(brace + 1, close - brace - 1));
+				format.remove_prefix(close + 1);
+				return;
+			}
+		}
 
-	class debug_cout : public std::ostream
-	{
-		bool need_newline = true;
+		/**
+		 * @brief Text after the last placeholder
+		 */
+		void format_tail(std::string_view format)
+		{
+			for (std::size_t brace; (brace = format.find_first_of("{}")) != std::string_view::npos; format.remove_prefix(brace + 2))
+				this->put_text(format.substr(0, brace + 1));
+			this->put_text(format);
+		}
 
-	public:
-		debug_cout(std::streambuf *sbuf)
-			: std::ios(sbuf), std::ostream(sbuf)
+		/**
+		 * @brief Fields of DEBUG_PREFIX, before the cached prefix
+		 */
+		void stamp()
 		{
+			char fields[DEBUG_PREFIX_SIZE];
+
+			records.put(fields, debug_stamp_write(fields));
 		}
-		debug_cout(debug_cout &&other)
-			: debug_cout(other.rdbuf())
+
+		void pad()
 		{
-			other.need_newline = false;
+			std::ostream &rc = records.stream;
+
+			// Recorded only: the binary record is cheaper than the text
+			if (debug_binary_on() || !this->enabled)
+				return this->pad_binary();
+			this->start = records.begin();
+			this->saved = {rc.flags(), rc.precision(), rc.fill()};
+			rc.flags(std::ios_base::dec | std::ios_base::skipws);
+			rc.precision(6);
+			rc.fill(' ');
+
+			this->entry();
+			if (debug_structured())
+			{
+				this->structured = true;
+				this->fields();
+				this->message = records.begin();
+				this->need_pad = false;
+				return;
+			}
+			this->stamp();
+			const std::string_view prefix = sites.prefix(this->site, this->location, this->level, debug_color(this->fd) ? site_registry::prefix_color : site_registry::prefix_plain);
+			records.put(prefix.data(), prefix.size());
+			this->message = records.begin();
+
+			this->need_pad = false;
 		}
-		~debug_cout()
+
+		debug_log(int fd, const std::source_location &location, const int l, site_registry::entry *site, unsigned char state)
+			: fd(fd), level(l), site(site), enabled((state & DEBUG_SITE_ON) && debug_sinks_accept(l)), recording(state & DEBUG_SITE_RECORD), location(location)
 		{
-			this->need_newline && (*this) << std::endl;
+			if (__builtin_expect(state & DEBUG_SITE_PROFILE, 0) && site != NULL)
+				debug_profile_begin(&this->profile);
 		}
-	};
 
-	std::string pad_right(std::string src, std::size_t total, char pchar = ' ')
-	{
-		std::string copy(src);
-		if (total > copy.size())
+		/**
+		 * @brief Tell how many records the policy of the statement dropped
+		 * @details As a record of its own, written before the current one.
+		 */
+		void report(const char *before, unsigned count, const char *after)
 		{
-			copy.insert(copy.size(), total - copy.size(), pchar);
+			const std::size_t at = records.begin();
+			char text[64];
+			const int len = std::snprintf(text, sizeof(text), "%s%u%s", before, count, after);
+
+			if (debug_structured())
+			{
+				this->fields();
+				debug_writer w = writer(sizeof(text) + 16, debug_format.mode, 1);
+				debug_writer_key(&w, "msg");
+				debug_writer_quoted(&w, text, len);
+				if (debug_format.mode == DEBUG_FORMAT_JSON)
+					debug_writer_raw(&w, "}", 1);
+				records.settle(w.p);
+			}
+			else
+			{
+				const std::string_view prefix = sites.prefix(this->site, this->location, this->level, debug_color(this->fd) ? site_registry::prefix_color : site_registry::prefix_plain);
+
+				this->stamp();
+				records.put(prefix.data(), prefix.size());
+				records.put(text, len);
+			}
+			records.end(at, this->fd, this->level);
+		}
+
+		/**
+		 * @brief Whether the record repeats the last one of the statement, see dedup()
+		 */
+		bool repeated()
+		{
+			const std::size_t from = this->binary ? this->start + DEBUG_BINARY_HEADER : this->message;
+			unsigned repeats;
+
+			if (!debug_limit_repeat(&this->site->limit, debug_limit_hash(records.at(from), records.begin() - from), &repeats))
+				return true;
+			if (repeats != 0)
+				this->report("last record repeated ", repeats, " times");
+			return false;
+		}
+
+		/**
+		 * @brief Write the record of the statement, once started
+		 */
+		void finish()
+		{
+			if (this->unique && this->enabled && this->site != NULL && this->repeated())
+				this->enabled = false;
+			if (this->binary)
+			{
+				records.end_binary(this->start, this->enabled, this->recording);
+				return;
+			}
+			// Structured, the recorder keeps the fields after the separator
+			this->close_message();
+			if (this->recording)
+				records.record(this->structured ? std::min(this->message + 1, records.begin()) : this->message, sites.id(this->site, this->location, this->level));
+			if (this->structured && debug_format.mode == DEBUG_FORMAT_JSON)
+				records.put("}", 1);
+			if (this->enabled)
+				records.end(this->start, this->fd, this->level);
+			else
+				records.drop(this->start);
+
+			std::ostream &rc = records.stream;
+			rc.flags(this->saved.flags);
+			rc.precision(this->saved.precision);
+			rc.fill(this->saved.fill);
+		}
+
+		/**
+		 * @brief Count the statement for DEBUG_PROFILE
+		 * @details Out of line: the destructor stays small enough to be inlined.
+		 */
+		__attribute__((noinline, cold)) void count()
+		{
+			debug_profile_end(&this->site->profile, this->level, this->location.file_name(), this->location.function_name(), this->location.line(), &this->profile);
+		}
+
+	protected:
+		/**
+		 * @brief Append the message of debug::log::info("took {} ms", ms)
+		 * @details Nothing is formatted when the statement is filtered out.
+		 * @param format Checked by format_string
+		 */
+		template <typename... Args>
+		void format(std::string_view format, Args &&...args)
+		{
+			if (!this->enabled && !this->recording)
+				return;
+			if (this->need_pad)
+				this->pad();
+			(this->format_next(format, std::forward<Args>(args)), ...);
+			this->format_tail(format);
 		}
-		return copy;
-	}
-	class debug_log
-	{
-		std::streambuf *sbuf;
-		std::source_location location;
-		bool need_pad = true;
 
 	public:
-		debug_log(std::streambuf *sbuf, const std::source_location &location) : sbuf(sbuf)
+		debug_log(int fd, const std::source_location &location, const int l, site_registry::slot &slot, unsigned char state)
+			: debug_log(fd, location, l, slot.site.load(std::memory_order_relaxed), state)
+		{
+		}
+		debug_log(int fd, const std::source_location &location)
+			: fd(fd), level(LOG_UNDEFINED), enabled(debug_filter_enabled()), recording(debug_recorder_on()), location(location)
 		{
-			this->location = location;
 		}
+		debug_log(const debug_log &) = delete;
+		debug_log &operator=(const debug_log &) = delete;
 		~debug_log()
 		{
+			if (!this->need_pad)
+				this->finish();
+			if (__builtin_expect(this->profile.start != 0, 0))
+				this->count();
+		}
+		/**
+		 * @brief Output one record out of n of the statement
+		 * @details The others are still recorded, see DEBUG_RECORDER.
+		 */
+		debug_log &every(unsigned n)
+		{
+			if (this->enabled && this->entry() != NULL && !debug_limit_every(&this->site->limit, n))
+				this->enabled = false;
+			return *this;
+		}
+
+		/**
+		 * @brief Output at most per_second records per second of the statement
+		 * @details How many were dropped is told before the next one which passes.
+		 */
+		debug_log &ratelimit(unsigned per_second)
+		{
+			unsigned dropped = 0;
+
+			if (!this->enabled || this->entry() == NULL)
+				return *this;
+			if (!debug_limit_rate(&this->site->limit, per_second, &dropped))
+				this->enabled = false;
+			else if (dropped != 0)
+				this->report("", dropped, " records over the rate limit");
+			return *this;
+		}
+
+		/**
+		 * @brief Collapse consecutive identical records of the statement
+		 * @details Into "last record repeated K times", told when a different one comes.
+		 */
+		debug_log &dedup()
+		{
+			this->unique = true;
+			return *this;
 		}
+
+		/**
+		 * @brief A key=value field after the message
+		 * @details With DEBUG_FORMAT, a field of the JSON or logfmt record,
+		 * written in place: numbers, booleans and strings keep their type.
+		 */
 		template <typename T>
-		debug_cout operator<<(T &&value)
+		debug_log &kv(const char *key, T &&value)
+		{
+			if (!this->enabled && !this->recording)
+				return *this;
+			if (this->need_pad)
+				this->pad();
+			if (this->binary)
+			{
+				// " key=" as one string, then the value
+				const bool first = records.begin() == this->start + DEBUG_BINARY_HEADER;
+				const std::uint16_t n = std::min<std::size_t>(std::strlen(key), DEBUG_BINARY_STRING - 2);
+				const std::uint16_t len = n + 2 - first;
+				const char type = DEBUG_ARG_STRING;
+
+				records.put(&type, 1);
+				records.put(&len, 2);
+				records.put(" ", !first);
+				records.put(key, n);
+				records.put("=", 1);
+				this->encode(std::forward<T>(value));
+				this->in_message = false;
+			}
+			else if (this->structured)
+				this->structured_kv(key, std::forward<T>(value));
+			else
+				this->text_kv(key, std::forward<T>(value));
+			return *this;
+		}
+		/**
+		 * @brief A field computed only when the statement passes, see lazy
+		 */
+		template <lazy F>
+		debug_log &kv(const char *key, F &&value)
 		{
-			char *strlevel = std::getenv("DEBUG");
-			if (strlevel == NULL)
-				return debug_cout(NULL);
-			if (std::atoi(strlevel) == 0)
-				return debug_cout(NULL);
+			if (!this->enabled && !this->recording)
+				return *this;
+			return this->kv(key, value());
+		}
 
-			debug_cout rc(sbuf);
+		/**
+		 * @brief Dump of a buffer after the message: offset, hexadecimal and ASCII columns
+		 * @details Large buffers are cut in the middle, see DEBUG_HEX. Structured,
+		 * "bytes" and "hex" fields; binary, the size and the first 64 bytes.
+		 */
+		debug_log &hex(const void *data, std::size_t len)
+		{
+			if (!this->enabled && !this->recording)
+				return *this;
 			if (this->need_pad)
+				this->pad();
+			if (this->binary)
 			{
-				rc << "        "
-					T_OUT(T_FG_YELLOW) << pad_right(this->location.file_name(), DEBUG_SPACING_FILE) << T_RESET " "
-					T_OUT(T_BOLD T_FG_WHITE) << pad_right(this->location.function_name(), DEBUG_SPACING_FUNCTION + DEBUG_SPACING_FUNCTION_CPP_ADD) << T_RESET " "
-					T_OUT(T_FG_CYAN) << std::setw(DEBUG_SPACING_LINE) << std::to_string(this->location.line()) << T_RESET " ";
-				
-				this->need_pad = false;
+				const bool first = records.begin() == this->start + DEBUG_BINARY_HEADER;
+				char text[32 + 2 * 64 + 3];
+				const int n = std::snprintf(text, 32, first ? "%zu bytes " : " (%zu bytes) ", len);
+
+				this->encode(std::string_view(text, n + debug_hex_string(text + n, data, len, 64)));
+			}
+			else if (this->structured)
+			{
+				const std::size_t max = debug_hex_tail(len) == len ? len : debug_hex.head;
+
+				this->close_message();
+				debug_writer w = writer(2 * max + 48, debug_format.mode, 1);
+				debug_writer_key(&w, "bytes");
+				debug_writer_uint(&w, len);
+				debug_writer_key(&w, "hex");
+				*w.p++ = '"';
+				w.p += debug_hex_string(w.p, data, len, max);
+				*w.p++ = '"';
+				records.settle(w.p);
+			}
+			else
+			{
+				const bool first = records.begin() == this->message;
+				char *p = records.room(32 + debug_hex_size(len));
+				const int n = std::snprintf(p, 32, first ? "%zu bytes" : " (%zu bytes)", len);
+
+				records.settle(p + n + debug_hex_lines(p + n, data, len));
 			}
-			rc << std::forward<T>(value);
-			return rc;
+			return *this;
 		}
-		debug_cout operator<<(std::ostream &(*manip)(std::ostream &))
+		template <typename R>
+			requires std::ranges::contiguous_range<R> && std::ranges::sized_range<R>
+		debug_log &hex(const R &range)
 		{
-			char *strlevel = std::getenv("DEBUG");
-			if (strlevel == NULL)
-				return debug_cout(NULL);
-			if (std::atoi(strlevel) == 0)
-				return debug_cout(NULL);
+			return this->hex(std::ranges::data(range), std::ranges::size(range) * sizeof(*std::ranges::data(range)));
+		}
 
-			debug_cout rc(sbuf);
-			rc << manip;
-			return rc;
+		template <typename T>
+		debug_log &operator<<(T &&value)
+		{
+			if (!this->enabled && !this->recording)
+				return *this;
+			if (this->need_pad)
+				this->pad();
+			this->open_message();
+			if (this->binary)
+				this->encode(std::forward<T>(value));
+			else if (this->structured)
+			{
+				const std::size_t from = records.begin();
+				records.stream << std::forward<T>(value);
+				records.escape(from);
+			}
+			else
+				records.stream << std::forward<T>(value);
+			return *this;
+		}
+		/**
+		 * @brief An operand computed only when the statement passes, see lazy
+		 */
+		template <lazy F>
+		debug_log &operator<<(F &&operand)
+		{
+			if (!this->enabled && !this->recording)
+				return *this;
+			return *this << operand();
+		}
+		debug_log &operator<<(std::ostream &(*manip)(std::ostream &))
+		{
+			if (!this->enabled && !this->recording)
+				return *this;
+			if (this->need_pad)
+				this->pad();
+			if (this->binary)
+				return *this;
+			if (this->structured)
+			{
+				this->open_message();
+				const std::size_t from = records.begin();
+				records.stream << manip;
+				records.escape(from);
+			}
+			else
+				records.stream << manip;
+			return *this;
 		}
 	};
 
-	debug_log cout(const std::source_location &location = std::source_location::current())
+	inline debug_log cout(const std::source_location &location = std::source_location::current())
 	{
-		return debug_log(std::cout.rdbuf(), location);
+		return debug_log(STDOUT_FILENO, location);
 	}
-	debug_log cerr(const std::source_location &location = std::source_location::current())
+	inline debug_log cerr(const std::source_location &location = std::source_location::current())
 	{
-		return debug_log(std::cout.rdbuf(), location);
+		return debug_log(STDERR_FILENO, location);
 	}
 	namespace log
 	{
-		class debug_level
+		class debug_level : public debug_log
 		{
-			std::streambuf *sbuf;
-			int level = LOG_UNDEFINED;
-			bool need_level = true;
-			std::source_location location;
-
 		public:
-			debug_level(std::streambuf *sbuf, const std::source_location &location, const int l) : sbuf(sbuf)
+			debug_level(int fd, const std::source_location &location, const int l, site_registry::slot &slot)
+				: debug_log(fd, location, l, slot, sites.state(slot, location, l))
 			{
-				this->location = location;
-				this->level = l;
 			}
-			template <typename T>
-			debug_cout operator<<(T &&value)
+			template <typename... Args>
+			debug_level(int fd, const std::source_location &location, const int l, site_registry::slot &slot, std::string_view format, Args &&...args)
+				: debug_log(fd, location, l, slot, sites.state(slot, location, l))
 			{
-				char *strlevel = std::getenv("DEBUG");
-				if (strlevel == NULL)
-					return debug_cout(NULL);
-				if (this->level > std::atoi(strlevel))
-					return debug_cout(NULL);
-
-				debug_cout rc(sbuf);
-				if (this->need_level)
-				{
-					switch (level)
-					{
-					case LOG_DEBUG:
-						rc << T_OUT(T_BOLD T_FG_WHITE) " DEBUG ";
-						break;
-					case LOG_INFO:
-						rc << T_OUT(T_BOLD T_FG_CYAN) " INFO  ";
-						break;
-					case LOG_WARNING:
-						rc << T_OUT(T_BOLD T_FG_YELLOW) " WARN  ";
-						break;
-					case LOG_ERROR:
-						rc << T_OUT(T_BOLD T_FG_RED) " ERROR ";
-						break;
-					case LOG_FATAL:
-						rc << T_OUT(T_REVERSE T_BOLD T_FG_RED) " FATAL ";
-						break;
-					default:
-						rc << T_OUT(T_REVERSE T_FG_WHITE) " TRACE ";
-						break;
-					}
-					rc << T_RESET " "
-					T_OUT(T_FG_YELLOW) << pad_right(this->location.file_name(), DEBUG_SPACING_FILE) << T_RESET " "
-					T_OUT(T_BOLD T_FG_WHITE) << pad_right(this->location.function_name(), DEBUG_SPACING_FUNCTION + DEBUG_SPACING_FUNCTION_CPP_ADD) << T_RESET " "
-					T_OUT(T_FG_CYAN) << std::setw(DEBUG_SPACING_LINE) << std::to_string(this->location.line()) << T_RESET " ";
-
-					this->need_level = false;
-				}
-				rc << std::forward<T>(value);
-				return rc;
+				this->format(format, std::forward<Args>(args)...);
 			}
-			debug_cout operator<<(std::ostream &(*manip)(std::ostream &))
+			template <lazy F>
+			debug_level(int fd, const std::source_location &location, const int l, site_registry::slot &slot, F &&message)
+				: debug_log(fd, location, l, slot, sites.state(slot, location, l))
 			{
-				char *strlevel = std::getenv("DEBUG");
-				if (strlevel == NULL)
-					return debug_cout(NULL);
-				if (this->level > std::atoi(strlevel))
-					return debug_cout(NULL);
-
-				debug_cout rc(sbuf);
-				rc << manip;
-				return rc;
+				*this << message;
 			}
 		};
-		debug_level fatal(const std::source_location &location = std::source_location::current())
+
+		/**
+		 * @brief Statement of level L, or nothing when L is above max_level
+		 * @param Tag Of the call site, see site_slot
+		 */
+		template <int L, typename Tag>
+		DEBUG_ALWAYS_INLINE auto statement(const std::source_location &location)
+		{
+			if constexpr (L <= max_level)
+				return debug_level(DEBUG_OUT, location, L, site_slot<Tag>);
+			else
+				return debug_none();
+		}
+		/**
+		 * @brief Statement of level L with a formatted message, arguments taken by reference
+		 */
+		template <int L, typename Tag, typename... Args>
+		DEBUG_ALWAYS_INLINE auto statement(const format<Args...> &format, Args &&...args)
+		{
+			if constexpr (L <= max_level)
+				return debug_level(DEBUG_OUT, format.location(), L, site_slot<Tag>, format.get(), std::forward<Args>(args)...);
+			else
+				return debug_none();
+		}
+		/**
+		 * @brief Statement of level L whose message is computed only when it passes
+		 */
+		template <int L, typename Tag, lazy F>
+		DEBUG_ALWAYS_INLINE auto statement(F &&message, const std::source_location &location)
+		{
+			if constexpr (L <= max_level)
+				return debug_level(DEBUG_OUT, location, L, site_slot<Tag>, std::forward<F>(message));
+			else
+				return debug_none();
+		}
+		template <typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto fatal(const std::source_location &location = std::source_location::current())
+		{
+			return statement<LOG_FATAL, Tag>(location);
+		}
+		template <typename... Args, typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto fatal(format<Args...> format, Args &&...args)
+		{
+			return statement<LOG_FATAL, Tag>(format, std::forward<Args>(args)...);
+		}
+		template <lazy F, typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto fatal(F &&message, const std::source_location &location = std::source_location::current())
+		{
+			return statement<LOG_FATAL, Tag>(std::forward<F>(message), location);
+		}
+		template <typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto error(const std::source_location &location = std::source_location::current())
+		{
+			return statement<LOG_ERROR, Tag>(location);
+		}
+		template <typename... Args, typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto error(format<Args...> format, Args &&...args)
+		{
+			return statement<LOG_ERROR, Tag>(format, std::forward<Args>(args)...);
+		}
+		template <lazy F, typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto error(F &&message, const std::source_location &location = std::source_location::current())
+		{
+			return statement<LOG_ERROR, Tag>(std::forward<F>(message), location);
+		}
+		template <typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto warning(const std::source_location &location = std::source_location::current())
+		{
+			return statement<LOG_WARNING, Tag>(location);
+		}
+		template <typename... Args, typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto warning(format<Args...> format, Args &&...args)
+		{
+			return statement<LOG_WARNING, Tag>(format, std::forward<Args>(args)...);
+		}
+		template <lazy F, typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto warning(F &&message, const std::source_location &location = std::source_location::current())
+		{
+			return statement<LOG_WARNING, Tag>(std::forward<F>(message), location);
+		}
+		template <typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto info(const std::source_location &location = std::source_location::current())
+		{
+			return statement<LOG_INFO, Tag>(location);
+		}
+		template <typename... Args, typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto info(format<Args...> format, Args &&...args)
+		{
+			return statement<LOG_INFO, Tag>(format, std::forward<Args>(args)...);
+		}
+		template <lazy F, typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto info(F &&message, const std::source_location &location = std::source_location::current())
+		{
+			return statement<LOG_INFO, Tag>(std::forward<F>(message), location);
+		}
+		template <typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto debug(const std::source_location &location = std::source_location::current())
 		{
-			return debug_level(std::cout.rdbuf(), location, LOG_FATAL);
+			return statement<LOG_DEBUG, Tag>(location);
 		}
-		debug_level error(const std::source_location &location = std::source_location::current())
+		template <typename... Args, typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto debug(format<Args...> format, Args &&...args)
 		{
-			return debug_level(std::cout.rdbuf(), location, LOG_ERROR);
+			return statement<LOG_DEBUG, Tag>(format, std::forward<Args>(args)...);
 		}
-		debug_level warning(const std::source_location &location = std::source_location::current())
+		template <lazy F, typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto debug(F &&message, const std::source_location &location = std::source_location::current())
 		{
-			return debug_level(std::cout.rdbuf(), location, LOG_WARNING);
+			return statement<LOG_DEBUG, Tag>(std::forward<F>(message), location);
 		}
-		debug_level info(const std::source_location &location = std::source_location::current())
+		template <typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto trace(const std::source_location &location = std::source_location::current())
 		{
-			return debug_level(std::cout.rdbuf(), location, LOG_INFO);
+			return statement<LOG_TRACE, Tag>(location);
 		}
-		debug_level debug(const std::source_location &location = std::source_location::current())
+		template <typename... Args, typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto trace(format<Args...> format, Args &&...args)
 		{
-			return debug_level(std::cout.rdbuf(), location, LOG_DEBUG);
+			return statement<LOG_TRACE, Tag>(format, std::forward<Args>(args)...);
 		}
-		debug_level trace(const std::source_location &location = std::source_location::current())
+		template <lazy F, typename Tag = decltype([] {})>
+		DEBUG_ALWAYS_INLINE auto trace(F &&message, const std::source_location &location = std::source_location::current())
 		{
-			return debug_level(std::cout.rdbuf(), location, LOG_TRACE);
+			return statement<LOG_TRACE, Tag>(std::forward<F>(message), location);
 		}
 	}
-#else
-#pragma GCC optimize ("O1")
-#pragma clang optimize on
-#pragma GCC push_options
-#pragma GCC optimize ("Os")
-
-	class debug_cout
+	namespace async
 	{
-	public:
-		template <typename T>
-		debug_cout &operator<<(T &&)
+		/**
+		 * @brief Write records from a dedicated thread, see DEBUG_ASYNC
+		 */
+		inline bool start(debug_overflow policy = DEBUG_OVERFLOW_BLOCK)
 		{
-			return *this;
+			return debug_async_start(policy) == 0;
+		}
+		/**
+		 * @brief Wait for the records queued so far to be written
+		 */
+		inline void flush()
+		{
+			debug_async_flush();
+		}
+		/**
+		 * @brief Write everything queued, then go back to synchronous writes
+		 */
+		inline void stop()
+		{
+			debug_async_stop();
+		}
+		/**
+		 * @brief Records dropped because the ring was full
+		 */
+		inline unsigned long dropped()
+		{
+			return __atomic_load_n(&debug_async.dropped, __ATOMIC_RELAXED);
+		}
+	}
+	/**
+	 * @brief Destinations of the records, each with its own level (see sink.h)
+	 * @details Once a sink is added, records only go to the sinks.
+	 */
+	namespace sink
+	{
+		inline debug_sink *fd(int fd, int level = LOG_TRACE)
+		{
+			return debug_sink_fd(fd, level);
+		}
+		inline debug_sink *file(const char *path, int level = LOG_TRACE)
+		{
+			return debug_sink_file(path, level);
+		}
+		inline debug_sink *rotate(const char *path, int level, std::size_t max_size, unsigned period = 0, int keep = 5)
+		{
+			return debug_sink_rotate(path, level, max_size, period, keep);
+		}
+		inline debug_sink *memory(std::size_t size, int level = LOG_TRACE)
+		{
+			return debug_sink_memory(size, level);
 		}
+		/**
+		 * @brief What a memory sink holds
+		 */
+		inline std::string read(debug_sink *sink)
+		{
+			std::string content(sink->size, '\0');
 
-		debug_cout &operator<<(std::ios_base &(*)(std::ios_base &))
+			content.resize(debug_sink_memory_read(sink, content.data(), content.size()));
+			return content;
+		}
+		inline void clear(debug_sink *sink)
 		{
-			return *this;
+			debug_sink_memory_clear(sink);
+		}
+		inline void remove(debug_sink *sink)
+		{
+			debug_sink_remove(sink);
+		}
+		inline void flush()
+		{
+			debug_sinks_flush();
 		}
+	}
 
-		debug_cout &operator<<(std::ios &(*)(std::ios &)) { return *this; }
+	/**
+	 * @brief Timer of a call site, with the location its summary is printed from
+	 */
+	struct located_timer
+	{
+		debug_timer timer; // First: report() gets back here from it
+		std::source_location location;
+		site_registry::entry *site;
 
-		debug_cout &operator<<(std::ostream &(*)(std::ostream &))
+		/**
+		 * @brief Print the summary, a record of DEBUG_TIMER_LEVEL from the site
+		 * @details Written straight to the output: at exit, the per thread buffers may be gone.
+		 */
+		static void report(const debug_timer *timer)
 		{
-			return *this;
+			const located_timer *self = reinterpret_cast<const located_timer *>(timer);
+			debug_timer_stats stats;
+
+			if (DEBUG_TIMER_LEVEL > max_level || !(sites.state(self->site, self->location, DEBUG_TIMER_LEVEL) & DEBUG_SITE_ON) || !debug_sinks_accept(DEBUG_TIMER_LEVEL))
+				return;
+			debug_timer_summary(timer, &stats);
+			if (debug_structured())
+			{
+				const std::string_view prefix = sites.prefix(self->site, self->location, DEBUG_TIMER_LEVEL, site_registry::prefix_structured);
+				debug_kv kv[DEBUG_TIMER_FIELDS];
+				char record[2048];
+				debug_writer w;
+
+				debug_timer_fields(timer, &stats, kv);
+				debug_writer_init(&w, record, sizeof(record), debug_format.mode);
+				debug_writer_open(&w);
+				if (w.fields++ != 0)
+					debug_writer_raw(&w, debug_format.mode == DEBUG_FORMAT_JSON ? "," : " ", 1);
+				debug_writer_raw(&w, prefix.data(), prefix.size());
+				debug_writer_key(&w, "msg");
+				debug_writer_quoted(&w, "timer", 5);
+				for (const debug_kv &field : kv)
+					debug_writer_kv(&w, &field);
+				debug_writer_end(&w);
+				debug_output(DEBUG_OUT, DEBUG_TIMER_LEVEL, record, w.p - record);
+				return;
+			}
+
+			std::string record(DEBUG_PREFIX_SIZE, '\0');
+			char message[512];
+
+			record.resize(debug_stamp_write(record.data()));
+			record += sites.prefix(self->site, self->location, DEBUG_TIMER_LEVEL, debug_color(DEBUG_OUT) ? site_registry::prefix_color : site_registry::prefix_plain);
+			record.append(message, debug_timer_message(timer, &stats, message, sizeof(message)));
+			record += '\n';
+			debug_output(DEBUG_OUT, DEBUG_TIMER_LEVEL, record.data(), record.size());
 		}
 	};
-	
-	debug_cout cout(const std::source_location &location = std::source_location::current())
+
+	/**
+	 * @brief Time the scope it lives in, as DEBUG_TIMER_BEGIN() and DEBUG_TIMER_END()
+	 * @details debug::scope_timer t("parse"); the duration goes into the
+	 * histogram of the call site when t is destroyed.
+	 */
+	class scope_timer
 	{
-		return debug_cout();
-	}
+		debug_timer *timer;
+		std::uint64_t start;
+
+		/**
+		 * @brief Timer of the call site, allocated the first time
+		 * @return NULL when the registry is full: nothing is timed
+		 */
+		static debug_timer *find(const char *name, const std::source_location &location)
+		{
+			site_registry::entry *site = sites.find(location, DEBUG_TIMER_LEVEL);
+			if (site == NULL)
+				return NULL;
+
+			debug_timer *timer = site->timer.load(std::memory_order_acquire);
+			if (timer != NULL)
+				return timer;
+
+			located_timer *fresh = new located_timer{{location.file_name(), location.function_name(), location.line(), name, located_timer::report, NULL, 0, 0, {}}, location, site};
+			if (!site->timer.compare_exchange_strong(timer, &fresh->timer, std::memory_order_acq_rel))
+			{
+				delete fresh;
+				return timer;
+			}
+			return &fresh->timer;
+		}
 
-	debug_cout cerr(const std::source_location &location = std::source_location::current())
+	public:
+		explicit scope_timer(const char *name, const std::source_location &location = std::source_location::current())
+			: timer(find(name, location)), start(debug_timer_now())
+		{
+		}
+		~scope_timer()
+		{
+			if (this->timer != NULL)
+				debug_timer_record(this->timer, debug_timer_now() - this->start);
+		}
+		scope_timer(const scope_timer &) = delete;
+		scope_timer &operator=(const scope_timer &) = delete;
+	};
+	/**
+	 * @brief Summaries of the timers, also printed at exit
+	 */
+	namespace timers
 	{
-		return debug_cout();
+		inline void report()
+		{
+			debug_timers_report();
+		}
+	}
+	/**
+	 * @brief Every statement: those of C in the debug_sites section, those of C++ met so far
+	 */
+	namespace statements
+	{
+		/**
+		 * @brief Print their level, state and location
+		 */
+		inline void list()
+		{
+			debug_sites_list();
+			sites.list();
+		}
+	}
+	/**
+	 * @brief Replace DEBUG at runtime, same grammar (see also DEBUG_CONTROL_FILE)
+	 * @details Every statement evaluates the new filter the next time it is reached.
+	 */
+	inline void set_filter(const char *filter)
+	{
+		debug_set_filter(filter);
+	}
+	/**
+	 * @brief Costliest statements, also printed at exit (see DEBUG_PROFILE)
+	 */
+	namespace profile
+	{
+		inline void report()
+		{
+			debug_profile_report();
+		}
+	}
+#else
+	/*
+	 * No std::source_location default argument: its strings would remain
+	 * without optimization.
+	 */
+	template <typename... Location>
+	DEBUG_ALWAYS_INLINE debug_none cout(Location &&...)
+	{
+		return debug_none();
+	}
+	template <typename... Location>
+	DEBUG_ALWAYS_INLINE debug_none cerr(Location &&...)
+	{
+		return debug_none();
 	}
+
+	/**
+	 * @brief Format string checked against Args as with DEBUG, nothing kept
+	 */
+	template <typename... Args>
+	class unlocated_format_string
+	{
+	public:
+		template <typename S>
+			requires std::is_convertible_v<const S &, std::string_view>
+		consteval unlocated_format_string(const S &text)
+		{
+			(void)format_string<Args...>(text);
+		}
+	};
+	template <typename... Args>
+	using unlocated_format = unlocated_format_string<std::type_identity_t<Args>...>;
+
+	template <typename T>
+	concept located = std::same_as<std::remove_cvref_t<T>, std::source_location>;
+
 	namespace log
 	{
-		debug_cout fatal(const std::source_location &location = std::source_location::current())
+		template <located... Location>
+		DEBUG_ALWAYS_INLINE debug_none fatal(Location &&...)
+		{
+			return debug_none();
+		}
+		template <typename... Args>
+		DEBUG_ALWAYS_INLINE debug_none fatal(unlocated_format<Args...>, Args &&...)
+		{
+			return debug_none();
+		}
+		template <lazy F, located... Location>
+		DEBUG_ALWAYS_INLINE debug_none fatal(F &&, Location &&...)
+		{
+			return debug_none();
+		}
+		template <located... Location>
+		DEBUG_ALWAYS_INLINE debug_none error(Location &&...)
+		{
+			return debug_none();
+		}
+		template <typename... Args>
+		DEBUG_ALWAYS_INLINE debug_none error(unlocated_format<Args...>, Args &&...)
+		{
+			return debug_none();
+		}
+		template <lazy F, located... Location>
+		DEBUG_ALWAYS_INLINE debug_none error(F &&, Location &&...)
+		{
+			return debug_none();
+		}
+		template <located... Location>
+		DEBUG_ALWAYS_INLINE debug_none warning(Location &&...)
+		{
+			return debug_none();
+		}
+		template <typename... Args>
+		DEBUG_ALWAYS_INLINE debug_none warning(unlocated_format<Args...>, Args &&...)
+		{
+			return debug_none();
+		}
+		template <lazy F, located... Location>
+		DEBUG_ALWAYS_INLINE debug_none warning(F &&, Location &&...)
+		{
+			return debug_none();
+		}
+		template <located... Location>
+		DEBUG_ALWAYS_INLINE debug_none info(Location &&...)
+		{
+			return debug_none();
+		}
+		template <typename... Args>
+		DEBUG_ALWAYS_INLINE debug_none info(unlocated_format<Args...>, Args &&...)
+		{
+			return debug_none();
+		}
+		template <lazy F, located... Location>
+		DEBUG_ALWAYS_INLINE debug_none info(F &&, Location &&...)
+		{
+			return debug_none();
+		}
+		template <located... Location>
+		DEBUG_ALWAYS_INLINE debug_none debug(Location &&...)
+		{
+			return debug_none();
+		}
+		template <typename... Args>
+		DEBUG_ALWAYS_INLINE debug_none debug(unlocated_format<Args...>, Args &&...)
 		{
-			return debug_cout();
+			return debug_none();
 		}
-		debug_cout error(const std::source_location &location = std::source_location::current())
+		template <lazy F, located... Location>
+		DEBUG_ALWAYS_INLINE debug_none debug(F &&, Location &&...)
 		{
-			return debug_cout();
+			return debug_none();
 		}
-		debug_cout warning(const std::source_location &location = std::source_location::current())
+		template <located... Location>
+		DEBUG_ALWAYS_INLINE debug_none trace(Location &&...)
 		{
-			return debug_cout();
+			return debug_none();
 		}
-		debug_cout info(const std::source_location &location = std::source_location::current())
+		template <typename... Args>
+		DEBUG_ALWAYS_INLINE debug_none trace(unlocated_format<Args...>, Args &&...)
 		{
-			return debug_cout();
+			return debug_none();
 		}
-		debug_cout debug(const std::source_location &location = std::source_location::current())
+		template <lazy F, located... Location>
+		DEBUG_ALWAYS_INLINE debug_none trace(F &&, Location &&...)
 		{
-			return debug_cout();
+			return debug_none();
 		}
-		debug_cout trace(const std::source_location &location = std::source_location::current())
+	}
+	namespace async
+	{
+		inline bool start(debug_overflow = DEBUG_OVERFLOW_BLOCK) { return true; }
+		inline void flush() {}
+		inline void stop() {}
+		inline unsigned long dropped() { return 0; }
+	}
+	namespace sink
+	{
+		inline debug_sink *fd(int, int = LOG_TRACE) { return nullptr; }
+		inline debug_sink *file(const char *, int = LOG_TRACE) { return nullptr; }
+		inline debug_sink *rotate(const char *, int, std::size_t, unsigned = 0, int = 5) { return nullptr; }
+		inline debug_sink *memory(std::size_t, int = LOG_TRACE) { return nullptr; }
+		inline std::string read(debug_sink *) { return std::string(); }
+		inline void clear(debug_sink *) {}
+		inline void remove(debug_sink *) {}
+		inline void flush() {}
+	}
+	class scope_timer
+	{
+	public:
+		template <typename... T>
+		DEBUG_ALWAYS_INLINE explicit scope_timer(T &&...)
 		{
-			return debug_cout();
 		}
+	};
+	namespace timers
+	{
+		inline void report() {}
+	}
+	namespace profile
+	{
+		inline void report() {}
+	}
+	namespace statements
+	{
+		inline void list() {}
 	}
-#pragma GCC pop_options
-#endif
+	inline void set_filter(const char *) {}
+#endif // (defined(DEBUG) || defined(DEBUG_LEVEL))
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,440 @@
+/*******************************************************************************
+ * @file		fields.h
+ * @brief		Structured output: records as JSON or logfmt lines
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_FIELDS_H
+#define DEBUG_FIELDS_H
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "binary.h"
+#include "stamp.h"
+
+/** Output format, see DEBUG_FORMAT */
+#define DEBUG_FORMAT_TEXT 0
+#define DEBUG_FORMAT_JSON 1
+#define DEBUG_FORMAT_LOGFMT 2
+
+struct debug_format
+{
+	int configured;
+	int mode; // DEBUG_FORMAT_*
+};
+
+DEBUG_SHARED struct debug_format debug_format = {0, DEBUG_FORMAT_TEXT};
+
+#define debug_structured() \
+	__builtin_expect(debug_format.mode != DEBUG_FORMAT_TEXT, 0)
+
+/**
+ * @brief Key and value of a structured record
+ */
+struct debug_kv
+{
+	const char *key;
+	int type; // DEBUG_ARG_I64, U64, DOUBLE, STRING or BOOL
+	union
+	{
+		long long i;
+		unsigned long long u;
+		double d;
+		const char *s;
+	} v;
+};
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief Read DEBUG_FORMAT=text|json|logfmt
+ */
+DEBUG_INTERNAL void debug_format_env(void)
+{
+	const char *mode = getenv("DEBUG_FORMAT");
+
+	if (__atomic_exchange_n(&debug_format.configured, 1, __ATOMIC_ACQ_REL))
+		return;
+	if (mode != NULL && strcmp(mode, "json") == 0)
+		__atomic_store_n(&debug_format.mode, DEBUG_FORMAT_JSON, __ATOMIC_RELAXED);
+	else if (mode != NULL && strcmp(mode, "logfmt") == 0)
+		__atomic_store_n(&debug_format.mode, DEBUG_FORMAT_LOGFMT, __ATOMIC_RELAXED);
+}
+#endif // DEBUG_DEFINITIONS
+
+/**
+ * @brief Encoder writing straight into a record
+ * @details Bounded: what does not fit is dropped, escape sequences and
+ * quoted strings are never cut in the middle.
+ */
+struct debug_writer
+{
+	char *p;
+	char *end;
+	int mode;	// DEBUG_FORMAT_JSON or DEBUG_FORMAT_LOGFMT
+	int fields; // Written so far
+};
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief Letter of the escape sequence of a byte, 'u' for \u00XX, 0 when there is none
+ */
+DEBUG_INTERNAL char debug_escape_of(unsigned char c)
+{
+	if (c >= 0x20 && c != '"' && c != '\\')
+		return 0;
+	switch (c)
+	{
+	case '"':
+	case '\\':
+		return c;
+	case '\n':
+		return 'n';
+	case '\r':
+		return 'r';
+	case '\t':
+		return 't';
+	case '\b':
+		return 'b';
+	case '\f':
+		return 'f';
+	default:
+		return 'u';
+	}
+}
+
+/**
+ * @brief Bytes added by escaping s
+ */
+DEBUG_INTERNAL size_t debug_escape_extra(const char *s, size_t n)
+{
+	size_t extra = 0;
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		char e = debug_escape_of(s[i]);
+
+		extra += e == 0 ? 0 : e == 'u' ? 5 : 1;
+	}
+	return extra;
+}
+
+/**
+ * @brief Escape n bytes where they are, from the end
+ * @param extra From debug_escape_extra(), s has room for n + extra bytes
+ */
+DEBUG_INTERNAL void debug_escape_inplace(char *s, size_t n, size_t extra)
+{
+	static const char hex[] = "0123456789abcdef";
+	char *dst = s + n + extra;
+
+	// Once dst meets the source, what is left is already in place
+	for (size_t i = n; i > 0 && dst != s + i; --i)
+	{
+		unsigned char c = s[i - 1];
+		char e = debug_escape_of(c);
+
+		if (e == 0)
+			*--dst = c;
+		else if (e == 'u')
+		{
+			dst -= 6;
+			memcpy(dst, "\\u00", 4);
+			dst[4] = hex[c >> 4];
+			dst[5] = hex[c & 15];
+		}
+		else
+		{
+			*--dst = e;
+			*--dst = '\\';
+		}
+	}
+}
+
+DEBUG_INTERNAL void debug_writer_raw(struct debug_writer *w, const char *s, size_t n)
+{
+	if (n > (size_t)(w->end - w->p))
+		n = w->end - w->p;
+	memcpy(w->p, s, n);
+	w->p += n;
+}
+
+/**
+ * @brief Escaped bytes, runs without escapes copied at once
+ */
+DEBUG_INTERNAL void debug_writer_escaped(struct debug_writer *w, const char *s, size_t n)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t run = 0;
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		unsigned char c = s[i];
+		char e = debug_escape_of(c);
+		size_t size = e == 'u' ? 6 : 2;
+
+		if (e == 0)
+			continue;
+		debug_writer_raw(w, s + run, i - run);
+		run = i + 1;
+		if ((size_t)(w->end - w->p) < size)
+		{
+			w->end = w->p; // Cut here, not in the middle of a sequence
+			return;
+		}
+		w->p[0] = '\\';
+		if (e == 'u')
+		{
+			memcpy(w->p + 1, "u00", 3);
+			w->p[4] = hex[c >> 4];
+			w->p[5] = hex[c & 15];
+		}
+		else
+			w->p[1] = e;
+		w->p += size;
+	}
+	debug_writer_raw(w, s + run, n - run);
+}
+
+/**
+ * @brief A string between quotes, the closing one always written
+ */
+DEBUG_INTERNAL void debug_writer_quoted(struct debug_writer *w, const char *s, size_t n)
+{
+	char *end = w->end;
+
+	if (end - w->p < 2)
+		return;
+	*w->p++ = '"';
+	w->end = end - 1;
+	debug_writer_escaped(w, s, n);
+	*w->p++ = '"';
+	w->end = end;
+}
+
+/**
+ * @brief "key": in JSON, key= in logfmt, after a separator when needed
+ */
+DEBUG_INTERNAL void debug_writer_key(struct debug_writer *w, const char *key)
+{
+	if (w->fields++ != 0)
+		debug_writer_raw(w, w->mode == DEBUG_FORMAT_JSON ? "," : " ", 1);
+	if (w->mode == DEBUG_FORMAT_JSON)
+	{
+		debug_writer_quoted(w, key, strlen(key));
+		debug_writer_raw(w, ":", 1);
+	}
+	else
+	{
+		debug_writer_escaped(w, key, strlen(key));
+		debug_writer_raw(w, "=", 1);
+	}
+}
+
+/**
+ * @brief A string value: always quoted in JSON, only when it has to be in logfmt
+ */
+DEBUG_INTERNAL void debug_writer_string(struct debug_writer *w, const char *s, size_t n)
+{
+	int quote = w->mode == DEBUG_FORMAT_JSON || n == 0;
+
+	if (s == NULL)
+	{
+		s = "(null)";
+		n = 6;
+	}
+	for (size_t i = 0; i < n && !quote; ++i)
+		quote = (unsigned char)s[i] <= ' ' || s[i] == '=' || s[i] == '"' || s[i] == '\\';
+	if (quote)
+		debug_writer_quoted(w, s, n);
+	else
+		debug_writer_raw(w, s, n);
+}
+
+DEBUG_INTERNAL void debug_writer_uint(struct debug_writer *w, unsigned long long v)
+{
+	char digits[24];
+	char *p = digits + sizeof(digits);
+
+	do
+	{
+		*--p = '0' + v % 10;
+		v /= 10;
+	} while (v != 0);
+	debug_writer_raw(w, p, digits + sizeof(digits) - p);
+}
+
+DEBUG_INTERNAL void debug_writer_int(struct debug_writer *w, long long v)
+{
+	if (v < 0)
+	{
+		debug_writer_raw(w, "-", 1);
+		debug_writer_uint(w, -(unsigned long long)v);
+	}
+	else
+		debug_writer_uint(w, v);
+}
+
+/**
+ * @details Shortest of 15 and 17 digits which reads back as v.
+ * JSON has no infinity nor NaN: null.
+ */
+DEBUG_INTERNAL void debug_writer_double(struct debug_writer *w, double v)
+{
+	char text[32];
+	int len;
+
+	if (!isfinite(v) && w->mode == DEBUG_FORMAT_JSON)
+	{
+		debug_writer_raw(w, "null", 4);
+		return;
+	}
+	len = snprintf(text, sizeof(text), "%.15g", v);
+	if (strtod(text, NULL) != v && isfinite(v))
+		len = snprintf(text, sizeof(text), "%.17g", v);
+	debug_writer_raw(w, text, len);
+}
+
+DEBUG_INTERNAL void debug_writer_bool(struct debug_writer *w, int v)
+{
+	debug_writer_raw(w, v ? "true" : "false", v ? 4 : 5);
+}
+
+DEBUG_INTERNAL void debug_writer_kv(struct debug_writer *w, const struct debug_kv *kv)
+{
+	debug_writer_key(w, kv->key);
+	switch (kv->type)
+	{
+	case DEBUG_ARG_I64:
+		debug_writer_int(w, kv->v.i);
+		break;
+	case DEBUG_ARG_U64:
+		debug_writer_uint(w, kv->v.u);
+		break;
+	case DEBUG_ARG_DOUBLE:
+		debug_writer_double(w, kv->v.d);
+		break;
+	case DEBUG_ARG_BOOL:
+		debug_writer_bool(w, kv->v.i != 0);
+		break;
+	default:
+		debug_writer_string(w, kv->v.s, kv->v.s != NULL ? strlen(kv->v.s) : 0);
+		break;
+	}
+}
+#else
+DEBUG_INTERNAL size_t debug_escape_extra(const char *s, size_t n);
+DEBUG_INTERNAL void debug_escape_inplace(char *s, size_t n, size_t extra);
+DEBUG_INTERNAL void debug_writer_raw(struct debug_writer *w, const char *s, size_t n);
+DEBUG_INTERNAL void debug_writer_quoted(struct debug_writer *w, const char *s, size_t n);
+DEBUG_INTERNAL void debug_writer_key(struct debug_writer *w, const char *key);
+DEBUG_INTERNAL void debug_writer_string(struct debug_writer *w, const char *s, size_t n);
+DEBUG_INTERNAL void debug_writer_uint(struct debug_writer *w, unsigned long long v);
+DEBUG_INTERNAL void debug_writer_int(struct debug_writer *w, long long v);
+DEBUG_INTERNAL void debug_writer_double(struct debug_writer *w, double v);
+DEBUG_INTERNAL void debug_writer_bool(struct debug_writer *w, int v);
+DEBUG_INTERNAL void debug_writer_kv(struct debug_writer *w, const struct debug_kv *kv);
+#endif // DEBUG_DEFINITIONS
+
+/** Bytes of debug_writer_open(), at most */
+#define DEBUG_FIELDS_OPEN 64
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief Open the record: the JSON object, then time and tid (see DEBUG_PREFIX)
+ */
+DEBUG_INTERNAL void debug_writer_open(struct debug_writer *w)
+{
+	int fields = __atomic_load_n(&debug_clock.fields, __ATOMIC_RELAXED);
+
+	if (w->mode == DEBUG_FORMAT_JSON)
+		debug_writer_raw(w, "{", 1);
+	if (fields & DEBUG_PREFIX_TIME)
+	{
+		debug_stamp_time(&debug_stamp);
+		debug_writer_key(w, "time");
+		debug_writer_quoted(w, debug_stamp.time, 26);
+	}
+	if (fields & DEBUG_PREFIX_TID)
+	{
+		debug_writer_key(w, "tid");
+		debug_writer_int(w, debug_thread_id());
+	}
+}
+
+/**
+ * @brief "fatal" ... "trace", NULL without level
+ */
+DEBUG_INTERNAL const char *debug_level_name(int level)
+{
+	static const char *const levels[] = {"fatal", "error", "warning", "info", "debug", "trace"};
+
+	return level >= LOG_FATAL && level <= LOG_TRACE ? levels[level - LOG_FATAL] : NULL;
+}
+
+/**
+ * @brief Fields of the statement: level, file, func, line
+ * @details The same for every record of a statement, C++ keeps them per site.
+ * @param level LOG_UNDEFINED for none
+ */
+DEBUG_INTERNAL void debug_writer_site(struct debug_writer *w, int level, const char *file, const char *func, unsigned line)
+{
+	const char *name = debug_level_name(level);
+
+	if (name != NULL)
+	{
+		debug_writer_key(w, "level");
+		debug_writer_string(w, name, strlen(name));
+	}
+	debug_writer_key(w, "file");
+	debug_writer_string(w, file, strlen(file));
+	debug_writer_key(w, "func");
+	debug_writer_string(w, func, strlen(func));
+	debug_writer_key(w, "line");
+	debug_writer_uint(w, line);
+}
+
+DEBUG_INTERNAL void debug_writer_head(struct debug_writer *w, int level, const char *file, const char *func, unsigned line)
+{
+	debug_writer_open(w);
+	debug_writer_site(w, level, file, func, line);
+}
+
+/**
+ * @brief Close the record, newline included
+ * @details The writer keeps 2 bytes for it, see debug_writer_init().
+ */
+DEBUG_INTERNAL void debug_writer_end(struct debug_writer *w)
+{
+	if (w->mode == DEBUG_FORMAT_JSON)
+		*w->p++ = '}';
+	*w->p++ = '\n';
+}
+
+DEBUG_INTERNAL void debug_writer_init(struct debug_writer *w, char *buf, size_t size, int mode)
+{
+	w->p = buf;
+	w->end = buf + size - 2;
+	w->mode = mode;
+	w->fields = 0;
+}
+#else
+DEBUG_INTERNAL void debug_writer_open(struct debug_writer *w);
+DEBUG_INTERNAL void debug_writer_site(struct debug_writer *w, int level, const char *file, const char *func, unsigned line);
+DEBUG_INTERNAL void debug_writer_end(struct debug_writer *w);
+DEBUG_INTERNAL void debug_writer_init(struct debug_writer *w, char *buf, size_t size, int mode);
+#endif // DEBUG_DEFINITIONS
+
+#endif // DEBUG_FIELDS_H
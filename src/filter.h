@@ -0,0 +1,312 @@
+/*******************************************************************************
+ * @file		filter.h
+ * @brief		Parse the DEBUG environment variable, or a filter set at runtime,
+ *				match call sites
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_FILTER_H
+#define DEBUG_FILTER_H
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "term.h"
+#include "glob.h"
+
+/** State of a call site, cached in a static next to the statement */
+#define DEBUG_SITE_UNKNOWN 0
+#define DEBUG_SITE_OFF 1
+#define DEBUG_SITE_ON 2
+#define DEBUG_SITE_RECORD 4 // Bit: kept by the flight recorder, see recorder.h
+#define DEBUG_SITE_PROFILE 8 // Bit: counted by DEBUG_PROFILE, see profile.h
+#define DEBUG_SITE_MASK 0xff // Of a state kept with the generation of the filter, see debug_filter_stamp
+
+#ifndef DEBUG_SITE_ARGS
+#define DEBUG_SITE_ARGS 16 // Arguments kept by the binary output
+#endif // DEBUG_SITE_ARGS
+
+/**
+ * @brief A statement of the C API, static next to it, in the debug_sites section
+ * @details Aligned so that the section is an array of them, see debug_sites_apply().
+ */
+struct __attribute__((aligned(64))) debug_site
+{
+	const char *file;
+	const char *func;
+	const char *format;
+	unsigned line;
+	int level;
+	unsigned char state;
+	unsigned char nargs;
+	unsigned char args[DEBUG_SITE_ARGS];
+	unsigned id;	  // Binary output, 0 until described
+	unsigned profile; // Slot of DEBUG_PROFILE, 0 until counted
+};
+
+/** Place a site in the debug_sites section, walked by the first statement */
+#define DEBUG_SITE_SECTION __attribute__((section("debug_sites"), used))
+
+#define DEBUG_SITE(level, format) \
+	{__FILE__, __func__, format, __LINE__, level, DEBUG_SITE_UNKNOWN, 0, {0}, 0, 0}
+
+/**
+ * @brief One `level:glob` entry of DEBUG
+ */
+struct debug_rule
+{
+	int level;
+	struct debug_glob name;
+};
+
+/**
+ * @brief DEBUG, compiled
+ * @details Never modified once published. One replaced by debug_set_filter()
+ * is freed once no thread matches against it, see debug_filter_readers.
+ */
+struct debug_filter
+{
+	int max_level; // highest level of all rules
+	int count;
+	struct debug_rule *rules; // NULL for the empty filter, which is not allocated
+	struct debug_filter *retired; // Next replaced filter not freed yet
+};
+
+/** Shared by every thread, and every translation unit */
+DEBUG_SHARED struct debug_filter *debug_filter_current;
+DEBUG_SHARED pthread_mutex_t debug_filter_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Threads matching against a filter, and the replaced filters they may still read
+ * @details The replaced filters are freed by the next debug_filter_set()
+ * that sees no thread matching: memory is bounded by the filters set while
+ * verdicts were being evaluated, which they are only once per statement and
+ * generation.
+ */
+DEBUG_SHARED unsigned debug_filter_readers;
+DEBUG_SHARED struct debug_filter *debug_filter_retired;
+
+/**
+ * @brief Generation of the filter, above DEBUG_SITE_MASK
+ * @details Bumped by each filter published. Never 0, so that a state of 0 is
+ * DEBUG_SITE_UNKNOWN whatever the generation.
+ */
+DEBUG_SHARED unsigned debug_filter_stamp = DEBUG_SITE_MASK + 1;
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief Parse a level character
+ * @return LOG_NONE to LOG_TRACE
+ */
+DEBUG_INTERNAL int debug_filter_level(char c)
+{
+	if (c == '*')
+		return LOG_TRACE;
+	if (c >= '0' + LOG_NONE && c <= '0' + LOG_TRACE)
+		return c - '0';
+	fprintf(stderr, "DEBUG: '%c' isn't recognised as a debugging level (max is " __STRINGIFY(LOG_TRACE) " = " STRINGIFY(LOG_TRACE) ")\n\n", c);
+	return LOG_TRACE;
+}
+
+/**
+ * @brief Parse one `;` separated entry of DEBUG
+ * @details `L`, `L:glob` or `glob`. A lone `*` is a level.
+ */
+DEBUG_INTERNAL int debug_filter_rule(struct debug_rule *rule, const char *token)
+{
+	const char *glob = "*";
+
+	rule->level = LOG_TRACE;
+	if (token[0] != '\0' && token[1] == ':')
+	{
+		rule->level = debug_filter_level(token[0]);
+		glob = &token[2];
+	}
+	else if (token[0] != '\0' && token[1] == '\0' && (token[0] == '*' || (token[0] >= '0' && token[0] <= '9')))
+		rule->level = debug_filter_level(token[0]);
+	else
+		glob = token;
+
+	if (debug_glob_compile(&rule->name, glob) != 0)
+	{
+		fprintf(stderr, "DEBUG: '%s' is too long (max is " STRINGIFY(DEBUG_GLOB_SIZE) " characters, " STRINGIFY(DEBUG_GLOB_SEGMENTS) " wildcards)\n", glob);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Compile a DEBUG value
+ * @param var NULL or empty for nothing enabled
+ */
+DEBUG_INTERNAL struct debug_filter *debug_filter_parse(const char *var)
+{
+	static struct debug_filter none;
+	struct debug_filter *filter;
+	char *copy;
+	char *save = NULL;
+	char *token;
+	int count = 1;
+
+	if (var == NULL || var[0] == '\0')
+		return &none;
+	for (const char *c = var; *c != '\0'; ++c)
+		count += *c == ';';
+	filter = (struct debug_filter *)calloc(1, sizeof(struct debug_filter) + count * sizeof(struct debug_rule));
+	copy = strdup(var);
+	if (filter == NULL || copy == NULL)
+	{
+		free(filter);
+		free(copy);
+		return &none;
+	}
+	filter->rules = (struct debug_rule *)(filter + 1);
+
+	for (token = strtok_r(copy, ";", &save); token != NULL; token = strtok_r(NULL, ";", &save))
+	{
+		struct debug_rule *rule = &filter->rules[filter->count];
+
+		if (debug_filter_rule(rule, token) != 0)
+			continue;
+		if (rule->level > filter->max_level)
+			filter->max_level = rule->level;
+		++filter->count;
+	}
+	free(copy);
+	return filter;
+}
+
+/**
+ * @brief Parse and compile DEBUG, only the first time
+ * @details Lock-free once published, the first threads wait for the parsing.
+ */
+DEBUG_INTERNAL struct debug_filter *debug_filter_get(void)
+{
+	struct debug_filter *filter = __atomic_load_n(&debug_filter_current, __ATOMIC_ACQUIRE);
+
+	if (__builtin_expect(filter != NULL, 1))
+		return filter;
+	pthread_mutex_lock(&debug_filter_lock);
+	filter = debug_filter_current;
+	if (filter == NULL)
+	{
+		filter = debug_filter_parse(getenv("DEBUG"));
+		__atomic_store_n(&debug_filter_current, filter, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&debug_filter_lock);
+	return filter;
+}
+
+/**
+ * @brief Publish a filter with the grammar of DEBUG, and a new generation
+ * @details Parsed by the caller: logging threads never wait for it.
+ * @param var NULL or empty for nothing enabled
+ */
+DEBUG_INTERNAL void debug_filter_set(const char *var)
+{
+	struct debug_filter *filter = debug_filter_parse(var);
+
+	struct debug_filter *old;
+	unsigned stamp;
+
+	pthread_mutex_lock(&debug_filter_lock);
+	stamp = debug_filter_stamp + DEBUG_SITE_MASK + 1;
+	old = __atomic_exchange_n(&debug_filter_current, filter, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&debug_filter_stamp, stamp != 0 ? stamp : DEBUG_SITE_MASK + 1, __ATOMIC_SEQ_CST);
+	if (old != NULL && old->rules != NULL)
+	{
+		old->retired = debug_filter_retired;
+		debug_filter_retired = old;
+	}
+	// A thread not counted yet loads the new filter
+	if (__atomic_load_n(&debug_filter_readers, __ATOMIC_SEQ_CST) == 0)
+		while (debug_filter_retired != NULL)
+		{
+			old = debug_filter_retired;
+			debug_filter_retired = old->retired;
+			free(old);
+		}
+	pthread_mutex_unlock(&debug_filter_lock);
+}
+
+/**
+ * @brief Whether a statement passes filter
+ * @param level loglevel of the statement
+ * @param file
+ * @param func
+ * @return DEBUG_SITE_ON or DEBUG_SITE_OFF
+ */
+DEBUG_INTERNAL int debug_filter_match(const struct debug_filter *filter, int level, const char *file, const char *func)
+{
+	struct debug_glob_subject sfile;
+	struct debug_glob_subject sfunc;
+
+	if (level < LOG_FATAL || level > filter->max_level)
+		return DEBUG_SITE_OFF;
+	debug_glob_scan(&sfile, file);
+	debug_glob_scan(&sfunc, func);
+	for (int i = 0; i < filter->count; ++i)
+	{
+		struct debug_rule *rule = &filter->rules[i];
+
+		if (level > rule->level)
+			continue;
+		if (debug_glob_match(&rule->name, &sfile) || debug_glob_match(&rule->name, &sfunc))
+			return DEBUG_SITE_ON;
+	}
+	return DEBUG_SITE_OFF;
+}
+
+/**
+ * @brief Filter to match against, until debug_filter_leave()
+ * @details Counted, so that debug_filter_set() does not free it meanwhile.
+ */
+DEBUG_INTERNAL const struct debug_filter *debug_filter_enter(void)
+{
+	__atomic_add_fetch(&debug_filter_readers, 1, __ATOMIC_SEQ_CST);
+	return debug_filter_get();
+}
+DEBUG_INTERNAL void debug_filter_leave(void)
+{
+	__atomic_sub_fetch(&debug_filter_readers, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Whether a statement passes DEBUG
+ * @return DEBUG_SITE_ON or DEBUG_SITE_OFF
+ */
+DEBUG_INTERNAL int debug_filter_site(int level, const char *file, const char *func)
+{
+	const int verdict = debug_filter_match(debug_filter_enter(), level, file, func);
+
+	debug_filter_leave();
+	return verdict;
+}
+
+/**
+ * @brief Whether DEBUG enables anything at all
+ */
+DEBUG_INTERNAL int debug_filter_enabled(void)
+{
+	const int enabled = debug_filter_enter()->max_level >= LOG_FATAL;
+
+	debug_filter_leave();
+	return enabled;
+}
+#else
+DEBUG_INTERNAL int debug_filter_enabled(void);
+#endif // DEBUG_DEFINITIONS
+
+#endif // DEBUG_FILTER_H
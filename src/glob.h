@@ -0,0 +1,189 @@
+/*******************************************************************************
+ * @file		glob.h
+ * @brief		Matching of the `*` wildcard names used in DEBUG
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_GLOB_H
+#define DEBUG_GLOB_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "common.h"
+
+#ifndef DEBUG_GLOB_SIZE
+#define DEBUG_GLOB_SIZE 256
+#endif // DEBUG_GLOB_SIZE
+#ifndef DEBUG_GLOB_SEGMENTS
+#define DEBUG_GLOB_SEGMENTS 16
+#endif // DEBUG_GLOB_SEGMENTS
+
+/**
+ * @brief Compiled glob
+ * @details The literals between the `*` are stored back to back in text.
+ * "main*loop*" has 2 segments, "main" anchored at start and "loop".
+ */
+struct debug_glob
+{
+	unsigned char anchored_start;
+	unsigned char anchored_end;
+	unsigned char count;
+	unsigned short min_len;
+	unsigned short offset[DEBUG_GLOB_SEGMENTS + 1]; // Segment i is text[offset[i]] to text[offset[i + 1]]
+	uint64_t bytes[4];								// Every byte the name must contain
+	char text[DEBUG_GLOB_SIZE];
+};
+
+/**
+ * @brief Name to match, scanned once for all the globs
+ */
+struct debug_glob_subject
+{
+	const char *str;
+	size_t len;
+	uint64_t bytes[4];
+};
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief Compile a glob
+ * @return 0, -1 when it does not fit in DEBUG_GLOB_SIZE/DEBUG_GLOB_SEGMENTS
+ */
+DEBUG_INTERNAL int debug_glob_compile(struct debug_glob *glob, const char *pattern)
+{
+	size_t len = 0;
+
+	memset(glob, 0, sizeof(*glob));
+	glob->anchored_start = pattern[0] != '*';
+	for (const char *c = pattern; *c != '\0'; ++c)
+	{
+		if (*c == '*')
+		{
+			// Close the current segment, empty ones are skipped ("**")
+			if (len != glob->offset[glob->count])
+			{
+				if (glob->count == DEBUG_GLOB_SEGMENTS)
+					return -1;
+				glob->offset[++glob->count] = len;
+			}
+			continue;
+		}
+		if (len == DEBUG_GLOB_SIZE)
+			return -1;
+		glob->text[len++] = *c;
+		glob->bytes[(unsigned char)*c >> 6] |= 1ULL << ((unsigned char)*c & 63);
+	}
+	glob->anchored_end = pattern[0] == '\0' || pattern[strlen(pattern) - 1] != '*';
+	if (len != glob->offset[glob->count])
+	{
+		if (glob->count == DEBUG_GLOB_SEGMENTS)
+			return -1;
+		glob->offset[++glob->count] = len;
+	}
+	glob->min_len = len;
+	return 0;
+}
+
+/**
+ * @brief Scan a name once, before matching it against several globs
+ */
+DEBUG_INTERNAL void debug_glob_scan(struct debug_glob_subject *subject, const char *str)
+{
+	const unsigned char *c = (const unsigned char *)str;
+
+	memset(subject->bytes, 0, sizeof(subject->bytes));
+	for (; *c != '\0'; ++c)
+		subject->bytes[*c >> 6] |= 1ULL << (*c & 63);
+	subject->str = str;
+	subject->len = (const char *)c - str;
+}
+
+/**
+ * @brief memmem(), which is not standard C
+ */
+DEBUG_INTERNAL const char *debug_glob_find(const char *str, size_t len, const char *needle, size_t needle_len)
+{
+	const char *end;
+
+	if (needle_len > len)
+		return NULL;
+	end = str + len - needle_len + 1;
+	while (str < end)
+	{
+		str = (const char *)memchr(str, needle[0], end - str);
+		if (str == NULL)
+			return NULL;
+		if (memcmp(str + 1, needle + 1, needle_len - 1) == 0)
+			return str;
+		++str;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Whether the whole name matches the glob
+ * @details Linear, without allocation. Each segment is searched once,
+ * leftmost match, which is enough for `*` only globs.
+ */
+DEBUG_INTERNAL int debug_glob_match(const struct debug_glob *glob, const struct debug_glob_subject *subject)
+{
+	const char *str = subject->str;
+	size_t begin = 0;
+	size_t end = subject->len;
+	unsigned first = 0;
+	unsigned last = glob->count;
+
+	if (subject->len < glob->min_len)
+		return 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		if ((glob->bytes[i] & subject->bytes[i]) != glob->bytes[i])
+			return 0;
+	}
+	if (glob->count == 0)
+		return !glob->anchored_start ? 1 : subject->len == 0;
+	if (glob->count == 1 && glob->anchored_start && glob->anchored_end)
+		return subject->len == glob->min_len && memcmp(str, glob->text, glob->min_len) == 0;
+
+	if (glob->anchored_start)
+	{
+		size_t len = glob->offset[1];
+
+		if (memcmp(str, glob->text, len) != 0)
+			return 0;
+		begin = len;
+		first = 1;
+	}
+	if (glob->anchored_end)
+	{
+		size_t len = glob->offset[last] - glob->offset[last - 1];
+
+		if (memcmp(str + end - len, glob->text + glob->offset[last - 1], len) != 0)
+			return 0;
+		end -= len;
+		--last;
+	}
+	for (unsigned i = first; i < last; ++i)
+	{
+		size_t len = glob->offset[i + 1] - glob->offset[i];
+		const char *found = debug_glob_find(str + begin, end - begin, glob->text + glob->offset[i], len);
+
+		if (found == NULL)
+			return 0;
+		begin = found - str + len;
+	}
+	return begin <= end;
+}
+#endif // DEBUG_DEFINITIONS
+
+#endif // DEBUG_GLOB_H
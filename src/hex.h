@@ -0,0 +1,188 @@
+/*******************************************************************************
+ * @file		hex.h
+ * @brief		Buffer dumps: offset, hexadecimal and ASCII columns
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_HEX_H
+#define DEBUG_HEX_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+/*
+ * A line, as hexdump -C, after a newline:
+ * 00000000  48 65 6c 6c 6f 20 77 6f  72 6c 64 0a 00 01 02 03  |Hello world.....|
+ */
+#define DEBUG_HEX_LINE 79 // Bytes of a line, its newline included
+#define DEBUG_HEX_SKIP 48 // Bytes of the line telling what was skipped, at most
+
+#ifndef DEBUG_HEX_HEAD
+#define DEBUG_HEX_HEAD 1024 // Default bytes dumped from the start of a large buffer
+#endif // DEBUG_HEX_HEAD
+
+#ifndef DEBUG_HEX_TAIL
+#define DEBUG_HEX_TAIL 256 // Default bytes dumped from its end
+#endif // DEBUG_HEX_TAIL
+
+/** "00" "01" ... "ff": two characters per byte */
+#define DEBUG_HEX_16(x) x "0" x "1" x "2" x "3" x "4" x "5" x "6" x "7" x "8" x "9" x "a" x "b" x "c" x "d" x "e" x "f"
+#define DEBUG_HEX_PAIRS                                                                       \
+	DEBUG_HEX_16("0") DEBUG_HEX_16("1") DEBUG_HEX_16("2") DEBUG_HEX_16("3") DEBUG_HEX_16("4") \
+	DEBUG_HEX_16("5") DEBUG_HEX_16("6") DEBUG_HEX_16("7") DEBUG_HEX_16("8") DEBUG_HEX_16("9") \
+	DEBUG_HEX_16("a") DEBUG_HEX_16("b") DEBUG_HEX_16("c") DEBUG_HEX_16("d") DEBUG_HEX_16("e") \
+	DEBUG_HEX_16("f")
+
+struct debug_hex
+{
+	int configured;
+	size_t head; // Both 0: no truncation
+	size_t tail;
+};
+
+DEBUG_SHARED struct debug_hex debug_hex = {0, DEBUG_HEX_HEAD, DEBUG_HEX_TAIL};
+
+#if DEBUG_DEFINITIONS
+static const char debug_hex_pairs[] = DEBUG_HEX_PAIRS;
+
+/**
+ * @brief Read DEBUG_HEX=head[,tail]: bytes dumped from the start and the end of a buffer
+ * @details DEBUG_HEX=0 dumps buffers whole.
+ */
+DEBUG_INTERNAL void debug_hex_env(void)
+{
+	const char *limits = getenv("DEBUG_HEX");
+	char *end;
+
+	if (__atomic_exchange_n(&debug_hex.configured, 1, __ATOMIC_ACQ_REL))
+		return;
+	if (limits == NULL || limits[0] == '\0')
+		return;
+	debug_hex.head = strtoul(limits, &end, 0);
+	debug_hex.tail = *end == ',' ? strtoul(end + 1, NULL, 0) : 0;
+}
+
+/**
+ * @brief Range of the buffer dumped after the head, len when it is whole
+ * @details The tail starts on a multiple of 16, as the lines of the head.
+ */
+DEBUG_INTERNAL size_t debug_hex_tail(size_t len)
+{
+	size_t from;
+
+	if ((debug_hex.head == 0 && debug_hex.tail == 0) || len <= debug_hex.head + debug_hex.tail)
+		return len;
+	from = (len - debug_hex.tail) & ~(size_t)15;
+	return from < debug_hex.head ? debug_hex.head : from;
+}
+
+/**
+ * @brief Bytes of the lines dumping len bytes, see debug_hex_lines()
+ */
+DEBUG_INTERNAL size_t debug_hex_size(size_t len)
+{
+	size_t from = debug_hex_tail(len);
+
+	if (from == len)
+		return (len + 15) / 16 * DEBUG_HEX_LINE;
+	return ((debug_hex.head + 15) / 16 + (len - from + 15) / 16) * DEBUG_HEX_LINE + DEBUG_HEX_SKIP;
+}
+
+/**
+ * @brief A line of at most 16 bytes, after a newline
+ * @param out DEBUG_HEX_LINE bytes
+ * @return Bytes written
+ */
+DEBUG_INTERNAL size_t debug_hex_line(char *out, const unsigned char *data, size_t n, size_t offset)
+{
+	char *p = out + 1;
+
+	out[0] = '\n';
+	for (int shift = 24; shift >= 0; shift -= 8, p += 2)
+		memcpy(p, debug_hex_pairs + 2 * ((offset >> shift) & 0xff), 2);
+	memset(p, ' ', 52);
+	p += 2;
+	for (size_t i = 0; i < n; ++i)
+		memcpy(p + 3 * i + (i >= 8), debug_hex_pairs + 2 * data[i], 2);
+	p += 50;
+	*p++ = '|';
+	for (size_t i = 0; i < n; ++i)
+		*p++ = (unsigned char)(data[i] - 0x20) < 0x5f ? data[i] : '.';
+	*p++ = '|';
+	return p - out;
+}
+
+/**
+ * @brief Lines of the bytes from..to of data, their offsets from data
+ */
+DEBUG_INTERNAL size_t debug_hex_range(char *out, const unsigned char *data, size_t from, size_t to)
+{
+	char *p = out;
+
+	size_t at = from;
+
+	// Full lines first: constant bounds, unrolled
+	for (; to - at >= 16 && at < to; at += 16)
+		p += debug_hex_line(p, data + at, 16, at);
+	if (at < to)
+		p += debug_hex_line(p, data + at, to - at, at);
+	return p - out;
+}
+
+/**
+ * @brief Lines of a buffer, truncated as DEBUG_HEX says
+ * @param out debug_hex_size(len) bytes
+ * @return Bytes written
+ */
+DEBUG_INTERNAL size_t debug_hex_lines(char *out, const void *data, size_t len)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	size_t from = debug_hex_tail(len);
+	char *p = out;
+
+	if (from == len)
+		return debug_hex_range(out, bytes, 0, len);
+	p += debug_hex_range(p, bytes, 0, debug_hex.head);
+	p += snprintf(p, DEBUG_HEX_SKIP, "\n...       %zu bytes skipped", from - debug_hex.head);
+	p += debug_hex_range(p, bytes, from, len);
+	return p - out;
+}
+
+/**
+ * @brief Bytes as one hexadecimal string, ".." after the first max ones
+ * @param out 2 * max + 3 bytes, NUL included
+ */
+DEBUG_INTERNAL size_t debug_hex_string(char *out, const void *data, size_t len, size_t max)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	size_t n = len < max ? len : max;
+
+	for (size_t i = 0; i < n; ++i)
+		memcpy(out + 2 * i, debug_hex_pairs + 2 * bytes[i], 2);
+	if (n != len)
+		memcpy(out + 2 * n, "..", 2);
+	n = 2 * n + (n != len ? 2 : 0);
+	out[n] = '\0';
+	return n;
+}
+#else
+DEBUG_INTERNAL size_t debug_hex_tail(size_t len);
+DEBUG_INTERNAL size_t debug_hex_size(size_t len);
+DEBUG_INTERNAL size_t debug_hex_lines(char *out, const void *data, size_t len);
+DEBUG_INTERNAL size_t debug_hex_string(char *out, const void *data, size_t len, size_t max);
+#endif // DEBUG_DEFINITIONS
+
+#endif // DEBUG_HEX_H
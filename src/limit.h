@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * @file		limit.h
+ * @brief		Per call site policies: rate limit, sampling, duplicates
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_LIMIT_H
+#define DEBUG_LIMIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "common.h"
+
+/**
+ * @brief State of the policy of a call site, zero to start
+ * @details Only atomic operations, no lock: each policy uses one or two words.
+ */
+struct debug_limit
+{
+	uint64_t next;	  // Rate limit: theoretical arrival time of the next record (ns). Sampling: calls
+	uint64_t last;	  // Duplicates: hash of the last record
+	unsigned dropped; // Since the last record which passed
+};
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief At most per_second records per second, in bursts of per_second at most
+ * @details Generic cell rate algorithm: a single CAS when a record passes, a
+ * load and an increment when it does not.
+ * @param dropped Records dropped before this one, when it passes
+ * @return Whether the record passes
+ */
+DEBUG_INTERNAL int debug_limit_rate(struct debug_limit *limit, unsigned per_second, unsigned *dropped)
+{
+	struct timespec ts;
+	uint64_t now;
+	uint64_t interval;
+	uint64_t next;
+	uint64_t tat;
+
+	if (per_second == 0)
+		return 0;
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+	now = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+	interval = 1000000000 / per_second;
+	tat = __atomic_load_n(&limit->next, __ATOMIC_RELAXED);
+	do
+	{
+		next = (tat > now ? tat : now) + interval;
+		if (next > now + 1000000000)
+		{
+			__atomic_fetch_add(&limit->dropped, 1, __ATOMIC_RELAXED);
+			return 0;
+		}
+	} while (!__atomic_compare_exchange_n(&limit->next, &tat, next, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	*dropped = __atomic_load_n(&limit->dropped, __ATOMIC_RELAXED) != 0 ? __atomic_exchange_n(&limit->dropped, 0, __ATOMIC_RELAXED) : 0;
+	return 1;
+}
+
+/**
+ * @brief One record out of n, the first one included
+ */
+DEBUG_INTERNAL int debug_limit_every(struct debug_limit *limit, unsigned n)
+{
+	return n <= 1 || __atomic_fetch_add(&limit->next, 1, __ATOMIC_RELAXED) % n == 0;
+}
+
+/**
+ * @brief FNV-1a, never 0
+ */
+DEBUG_INTERNAL uint64_t debug_limit_hash(const char *data, size_t len)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < len; ++i)
+		h = (h ^ (unsigned char)data[i]) * 0x100000001b3ULL;
+	return h | 1;
+}
+
+/**
+ * @brief Whether a record differs from the previous one of the site
+ * @param hash Of the record, from debug_limit_hash()
+ * @param repeats How many times the previous one was repeated, when it differs
+ */
+DEBUG_INTERNAL int debug_limit_repeat(struct debug_limit *limit, uint64_t hash, unsigned *repeats)
+{
+	if (__atomic_exchange_n(&limit->last, hash, __ATOMIC_RELAXED) == hash)
+	{
+		__atomic_fetch_add(&limit->dropped, 1, __ATOMIC_RELAXED);
+		return 0;
+	}
+	*repeats = __atomic_load_n(&limit->dropped, __ATOMIC_RELAXED) != 0 ? __atomic_exchange_n(&limit->dropped, 0, __ATOMIC_RELAXED) : 0;
+	return 1;
+}
+#else
+DEBUG_INTERNAL int debug_limit_rate(struct debug_limit *limit, unsigned per_second, unsigned *dropped);
+DEBUG_INTERNAL int debug_limit_every(struct debug_limit *limit, unsigned n);
+DEBUG_INTERNAL uint64_t debug_limit_hash(const char *data, size_t len);
+DEBUG_INTERNAL int debug_limit_repeat(struct debug_limit *limit, uint64_t hash, unsigned *repeats);
+#endif // DEBUG_DEFINITIONS
+
+#endif // DEBUG_LIMIT_H
@@ -0,0 +1,316 @@
+/*******************************************************************************
+ * @file		output.h
+ * @brief		Where formatted records go
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_OUTPUT_H
+#define DEBUG_OUTPUT_H
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "term.h"
+#include "async.h"
+#include "binary.h"
+#include "control.h"
+#include "fields.h"
+#include "hex.h"
+#include "profile.h"
+#include "filter.h"
+#include "sink.h"
+#include "stamp.h"
+
+/** Outputs written with colors, see debug_color() */
+#define DEBUG_COLOR_OTHER 1 // Other fds, and sinks
+#define DEBUG_COLOR_STDOUT 2
+#define DEBUG_COLOR_STDERR 4
+
+struct debug_color
+{
+	int configured;
+	int outputs; // DEBUG_COLOR_*
+};
+
+DEBUG_SHARED struct debug_color debug_color_state = {0, DEBUG_COLOR_STDOUT | DEBUG_COLOR_STDERR};
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief Read DEBUG_COLOR=never|always|auto and NO_COLOR, check the terminals
+ * @details auto, the default, colors the standard output and error when they
+ * are terminals and NO_COLOR is not set.
+ */
+DEBUG_INTERNAL void debug_color_env(void)
+{
+	const char *mode = getenv("DEBUG_COLOR");
+	const char *no_color = getenv("NO_COLOR");
+	int outputs = 0;
+
+	if (__atomic_exchange_n(&debug_color_state.configured, 1, __ATOMIC_ACQ_REL))
+		return;
+	if (mode != NULL && strcmp(mode, "always") == 0)
+		outputs = DEBUG_COLOR_OTHER | DEBUG_COLOR_STDOUT | DEBUG_COLOR_STDERR;
+	else if ((mode == NULL || strcmp(mode, "never") != 0) && (no_color == NULL || no_color[0] == '\0'))
+		outputs = (isatty(STDOUT_FILENO) ? DEBUG_COLOR_STDOUT : 0) | (isatty(STDERR_FILENO) ? DEBUG_COLOR_STDERR : 0);
+	__atomic_store_n(&debug_color_state.outputs, outputs, __ATOMIC_RELAXED);
+}
+#endif // DEBUG_DEFINITIONS
+
+/**
+ * @brief Bounds of the debug_sites section, given by the linker: every C
+ * statement of the program, or of the library
+ */
+extern struct debug_site __start_debug_sites[] __attribute__((weak, visibility("hidden")));
+extern struct debug_site __stop_debug_sites[] __attribute__((weak, visibility("hidden")));
+
+/**
+ * @brief A debug_sites section, once evaluated
+ * @details Linked to those of the other libraries, for debug_set_filter().
+ */
+struct debug_sites
+{
+	struct debug_site *start;
+	struct debug_site *stop;
+	struct debug_sites *next;
+	int applied;
+};
+
+/** The section of the program or library, once for every translation unit */
+__attribute__((weak, visibility("hidden"))) struct debug_sites debug_sites_local = {__start_debug_sites, __stop_debug_sites, NULL, 0};
+
+/** Every section evaluated so far */
+DEBUG_SHARED struct debug_sites *debug_sites_head;
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief State of a statement: DEBUG, then the flight recorder and the profiler on top
+ * @return DEBUG_SITE_ON or DEBUG_SITE_OFF, with DEBUG_SITE_RECORD when recording,
+ * DEBUG_SITE_PROFILE when profiling: then even a filtered out statement is counted.
+ */
+DEBUG_INTERNAL unsigned char debug_site_judge(int level, const char *file, const char *func)
+{
+	return debug_filter_site(level, file, func) | (debug_recorder_on() ? DEBUG_SITE_RECORD : 0) | (debug_profile_on() ? DEBUG_SITE_PROFILE : 0);
+}
+
+/**
+ * @brief Read the environment: DEBUG_CLOCK, DEBUG_PREFIX, DEBUG_ASYNC, DEBUG_BINARY, DEBUG_RECORDER, DEBUG_COLOR, DEBUG_FORMAT, DEBUG_HEX, DEBUG_PROFILE, DEBUG_CONTROL_FILE
+ * @details Once, at startup or by the first statement.
+ */
+DEBUG_INTERNAL __attribute__((constructor)) void debug_configure(void)
+{
+	static int configured;
+
+	if (__atomic_load_n(&configured, __ATOMIC_ACQUIRE))
+		return;
+	debug_clock_env();
+	debug_async_env();
+	debug_binary_env();
+	debug_recorder_env();
+	debug_color_env();
+	debug_format_env();
+	debug_hex_env();
+	debug_profile_env();
+	debug_control_env();
+	__atomic_store_n(&configured, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Verdict of DEBUG for a statement, once configured
+ * @return See debug_site_judge()
+ */
+DEBUG_INTERNAL unsigned char debug_site_verdict(int level, const char *file, const char *func)
+{
+	debug_configure();
+	return debug_site_judge(level, file, func);
+}
+
+/**
+ * @brief Forget the states of a section: each statement evaluates DEBUG again when reached
+ */
+DEBUG_INTERNAL void debug_sites_forget(struct debug_sites *sites)
+{
+	for (struct debug_site *site = sites->start; site != sites->stop; ++site)
+		__atomic_store_n(&site->state, DEBUG_SITE_UNKNOWN, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Replace DEBUG at runtime, same grammar
+ * @details The filter is published, then the states of the C statements
+ * forgotten: each one evaluates it the next time it is reached, the C++ ones
+ * see its generation. Logging threads never wait.
+ * @param filter NULL or empty for nothing enabled
+ */
+DEBUG_INTERNAL void debug_set_filter(const char *filter)
+{
+	debug_filter_set(filter);
+	for (struct debug_sites *sites = __atomic_load_n(&debug_sites_head, __ATOMIC_SEQ_CST); sites != NULL; sites = sites->next)
+		debug_sites_forget(sites);
+}
+
+/**
+ * @brief Whether the records written to fd have colors
+ * @details Decided once; with sinks, only DEBUG_COLOR=always gives colors.
+ */
+DEBUG_INTERNAL int debug_color(int fd)
+{
+	int outputs = __atomic_load_n(&debug_color_state.outputs, __ATOMIC_RELAXED);
+
+	if (__atomic_load_n(&debug_sinks.count, __ATOMIC_RELAXED) != 0)
+		return outputs & DEBUG_COLOR_OTHER;
+	return outputs & (fd == STDOUT_FILENO ? DEBUG_COLOR_STDOUT : fd == STDERR_FILENO ? DEBUG_COLOR_STDERR : DEBUG_COLOR_OTHER);
+}
+
+/**
+ * @brief Tag of a loglevel, DEBUG_TAG_NONE without level
+ * @param color Colored or plain
+ */
+DEBUG_INTERNAL const char *debug_tag(int level, int color)
+{
+	static const char *const tags[2][LOG_TRACE + 2] = {
+		{DEBUG_TAG_NONE, DEBUG_TAG_TRACE_PLAIN, DEBUG_TAG_FATAL_PLAIN, DEBUG_TAG_ERROR_PLAIN, DEBUG_TAG_WARNING_PLAIN, DEBUG_TAG_INFO_PLAIN, DEBUG_TAG_DEBUG_PLAIN, DEBUG_TAG_TRACE_PLAIN},
+		{DEBUG_TAG_NONE, DEBUG_TAG_TRACE, DEBUG_TAG_FATAL, DEBUG_TAG_ERROR, DEBUG_TAG_WARNING, DEBUG_TAG_INFO, DEBUG_TAG_DEBUG, DEBUG_TAG_TRACE},
+	};
+
+	if (level < LOG_UNDEFINED || level > LOG_TRACE)
+		level = LOG_TRACE;
+	return tags[color != 0][level + 1];
+}
+
+/**
+ * @brief Output a whole record, newline included
+ * @details To every sink whose level passes, or to fd when there is none.
+ * @param level loglevel of the record, LOG_UNDEFINED without level
+ */
+DEBUG_INTERNAL void debug_output(int fd, int level, const char *buf, size_t len)
+{
+	debug_configure();
+	if (debug_profile_on())
+		debug_profile_written += len;
+	if (__atomic_load_n(&debug_sinks.count, __ATOMIC_ACQUIRE) != 0)
+		debug_sinks_write(level, buf, len);
+	else
+		debug_output_fd(fd, buf, len);
+}
+
+/**
+ * @brief A statement of debug_sites_list(), as text or structured
+ * @return Bytes written
+ */
+DEBUG_INTERNAL size_t debug_site_line(char *out, size_t size, int level, const char *file, const char *func, unsigned line, unsigned char state)
+{
+	const char *name = debug_level_name(level);
+	const char *verdict = state == DEBUG_SITE_UNKNOWN ? "unknown" : (state & DEBUG_SITE_ON) ? "on" : "off";
+	struct debug_writer w;
+	int n;
+
+	if (!debug_structured())
+	{
+		n = snprintf(out, size, "%-7s %-7s %s:%u %s\n", name != NULL ? name : "-", verdict, file, line, func);
+		return n < 0 ? 0 : (size_t)n >= size ? size - 1 : (size_t)n;
+	}
+	debug_writer_init(&w, out, size, debug_format.mode);
+	if (w.mode == DEBUG_FORMAT_JSON)
+		debug_writer_raw(&w, "{", 1);
+	debug_writer_site(&w, level, file, func, line);
+	debug_writer_key(&w, "state");
+	debug_writer_string(&w, verdict, strlen(verdict));
+	debug_writer_end(&w);
+	return w.p - out;
+}
+#else
+DEBUG_INTERNAL unsigned char debug_site_judge(int level, const char *file, const char *func);
+DEBUG_INTERNAL void debug_configure(void);
+DEBUG_INTERNAL unsigned char debug_site_verdict(int level, const char *file, const char *func);
+DEBUG_INTERNAL void debug_sites_forget(struct debug_sites *sites);
+DEBUG_INTERNAL void debug_set_filter(const char *filter);
+DEBUG_INTERNAL int debug_color(int fd);
+DEBUG_INTERNAL const char *debug_tag(int level, int color);
+DEBUG_INTERNAL void debug_output(int fd, int level, const char *buf, size_t len);
+DEBUG_INTERNAL size_t debug_site_line(char *out, size_t size, int level, const char *file, const char *func, unsigned line, unsigned char state);
+#endif // DEBUG_DEFINITIONS
+
+/**
+ * @brief Evaluate DEBUG for every C statement at once, from the debug_sites section
+ * @details By the first statement reached: the others then only load their state.
+ */
+DEBUG_LOCAL void debug_sites_apply(void)
+{
+	const unsigned stamp = __atomic_load_n(&debug_filter_stamp, __ATOMIC_SEQ_CST);
+	struct debug_sites *head = __atomic_load_n(&debug_sites_head, __ATOMIC_RELAXED);
+
+	for (struct debug_site *site = __start_debug_sites; site != __stop_debug_sites; ++site)
+		__atomic_store_n(&site->state, debug_site_judge(site->level, site->file, site->func), __ATOMIC_RELAXED);
+	do
+		debug_sites_local.next = head;
+	while (!__atomic_compare_exchange_n(&debug_sites_head, &head, &debug_sites_local, 1, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+	// A filter published meanwhile may have missed the section
+	if (__atomic_load_n(&debug_filter_stamp, __ATOMIC_SEQ_CST) != stamp)
+		debug_sites_forget(&debug_sites_local);
+}
+
+/**
+ * @brief debug_sites_apply(), the first time only
+ */
+DEBUG_LOCAL void debug_sites_configure(void)
+{
+	if (__atomic_load_n(&debug_sites_local.applied, __ATOMIC_ACQUIRE) || __atomic_exchange_n(&debug_sites_local.applied, 1, __ATOMIC_ACQ_REL))
+		return;
+	debug_configure();
+	debug_sites_apply();
+}
+
+/**
+ * @brief Evaluate DEBUG for a site, the first time it is reached and after debug_set_filter()
+ * @details Threads reaching it together agree, the state is stored atomically.
+ * A filter published meanwhile leaves the site unknown, to evaluate again.
+ * @return See debug_site_verdict()
+ */
+DEBUG_LOCAL DEBUG_COLD unsigned char debug_site_state(struct debug_site *site)
+{
+	unsigned stamp;
+	unsigned char state;
+
+	debug_sites_configure();
+	stamp = __atomic_load_n(&debug_filter_stamp, __ATOMIC_SEQ_CST);
+	state = debug_site_verdict(site->level, site->file, site->func);
+
+	__atomic_store_n(&site->state, state, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&debug_filter_stamp, __ATOMIC_SEQ_CST) != stamp)
+		__atomic_store_n(&site->state, DEBUG_SITE_UNKNOWN, __ATOMIC_RELAXED);
+	return state;
+}
+
+/**
+ * @brief State of a site, evaluated when unknown
+ */
+DEBUG_LOCAL unsigned char debug_site_current(struct debug_site *site)
+{
+	unsigned char state = __atomic_load_n(&site->state, __ATOMIC_RELAXED);
+
+	return state != DEBUG_SITE_UNKNOWN ? state : debug_site_state(site);
+}
+
+/**
+ * @brief Print every C statement of the program: level, state, location
+ * @details From the debug_sites section, reached or not.
+ */
+DEBUG_LOCAL void debug_sites_list(void)
+{
+	char line[1024];
+
+	debug_sites_configure();
+	for (struct debug_site *site = __start_debug_sites; site != __stop_debug_sites; ++site)
+		debug_output(DEBUG_OUT, LOG_UNDEFINED, line, debug_site_line(line, sizeof(line), site->level, site->file, site->func, site->line, debug_site_current(site)));
+}
+
+#endif // DEBUG_OUTPUT_H
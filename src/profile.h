@@ -0,0 +1,286 @@
+/*******************************************************************************
+ * @file		profile.h
+ * @brief		Self-profiling: calls, suppressed calls, bytes and time of each
+ *				statement, the costliest ones reported at exit
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_PROFILE_H
+#define DEBUG_PROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "fields.h"
+#include "filter.h"
+#include "stamp.h"
+#include "timer.h"
+
+#ifndef DEBUG_PROFILE_SITES
+#define DEBUG_PROFILE_SITES 4096 // Statements counted, the others are not
+#endif // DEBUG_PROFILE_SITES
+
+#ifndef DEBUG_PROFILE_SHARDS
+#define DEBUG_PROFILE_SHARDS 16 // Copies of the counters, threads spread over them
+#endif // DEBUG_PROFILE_SHARDS
+
+/**
+ * @brief Counters of a statement in one shard
+ */
+struct debug_profile_counts
+{
+	uint64_t calls;
+	uint64_t suppressed; // Calls which output nothing: filtered out, or dropped by their policy
+	uint64_t bytes;		 // Output
+	uint64_t ticks;		 // In formatting and output, see debug_timer_now()
+};
+
+/**
+ * @brief Statement of a slot
+ */
+struct debug_profile_site
+{
+	const char *file;
+	const char *func;
+	unsigned line;
+	int level;
+};
+
+struct debug_profile
+{
+	int configured;
+	int on;
+	unsigned top;  // Statements reported
+	unsigned used; // Slots given so far
+	struct debug_profile_site *sites;
+	struct debug_profile_counts *counts; // [DEBUG_PROFILE_SHARDS][DEBUG_PROFILE_SITES]
+};
+
+DEBUG_SHARED struct debug_profile debug_profile;
+
+/** Bytes output by the thread, see debug_output() */
+DEBUG_SHARED __thread size_t debug_profile_written;
+
+/**
+ * @brief A call being counted
+ */
+struct debug_profile_call
+{
+	uint64_t start; // 0 when not counted
+	size_t written;
+};
+
+#define debug_profile_on() \
+	__builtin_expect(__atomic_load_n(&debug_profile.on, __ATOMIC_RELAXED), 0)
+
+#if DEBUG_DEFINITIONS
+DEBUG_INTERNAL void debug_output(int fd, int level, const char *buf, size_t len);
+DEBUG_INTERNAL void debug_profile_report(void);
+
+/**
+ * @brief Read DEBUG_PROFILE=N: count every statement, report the N costliest at exit
+ */
+DEBUG_INTERNAL void debug_profile_env(void)
+{
+	const char *top = getenv("DEBUG_PROFILE");
+	struct debug_profile_site *sites;
+	struct debug_profile_counts *counts;
+
+	if (__atomic_exchange_n(&debug_profile.configured, 1, __ATOMIC_ACQ_REL))
+		return;
+	if (top == NULL || strtoul(top, NULL, 0) == 0)
+		return;
+	sites = (struct debug_profile_site *)calloc(DEBUG_PROFILE_SITES, sizeof(*sites));
+	counts = (struct debug_profile_counts *)calloc((size_t)DEBUG_PROFILE_SHARDS * DEBUG_PROFILE_SITES, sizeof(*counts));
+	if (sites == NULL || counts == NULL)
+	{
+		free(sites);
+		free(counts);
+		return;
+	}
+	debug_profile.top = strtoul(top, NULL, 0);
+	debug_profile.sites = sites;
+	debug_profile.counts = counts;
+	__atomic_store_n(&debug_profile.on, 1, __ATOMIC_RELEASE);
+	atexit(debug_profile_report);
+}
+
+/**
+ * @brief Start counting a call
+ */
+DEBUG_INTERNAL void debug_profile_begin(struct debug_profile_call *call)
+{
+	call->written = debug_profile_written;
+	call->start = debug_timer_now() | 1;
+}
+
+/**
+ * @brief Slot of a statement, given the first time it is counted
+ * @param slot Of the statement, 0 until given
+ * @return 0 when every slot is taken
+ */
+DEBUG_INTERNAL unsigned debug_profile_slot(unsigned *slot, int level, const char *file, const char *func, unsigned line)
+{
+	unsigned given = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+	unsigned none = 0;
+
+	if (given != 0)
+		return given;
+	given = __atomic_add_fetch(&debug_profile.used, 1, __ATOMIC_RELAXED);
+	if (given > DEBUG_PROFILE_SITES)
+		return 0;
+	debug_profile.sites[given - 1].file = file;
+	debug_profile.sites[given - 1].func = func;
+	debug_profile.sites[given - 1].line = line;
+	debug_profile.sites[given - 1].level = level;
+	// A thread which lost the race leaves an empty slot
+	if (!__atomic_compare_exchange_n(slot, &none, given, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		return none;
+	return given;
+}
+
+/**
+ * @brief Count a call in the shard of the thread
+ * @details Threads mostly write counters of their own shard, whose cache
+ * lines do not bounce between them.
+ */
+DEBUG_INTERNAL void debug_profile_end(unsigned *slot, int level, const char *file, const char *func, unsigned line, const struct debug_profile_call *call)
+{
+	const uint64_t ticks = debug_timer_now() - call->start;
+	const size_t bytes = debug_profile_written - call->written;
+	unsigned given = debug_profile_slot(slot, level, file, func, line);
+	struct debug_profile_counts *counts;
+
+	if (given == 0)
+		return;
+	counts = &debug_profile.counts[(size_t)(debug_thread_id() % DEBUG_PROFILE_SHARDS) * DEBUG_PROFILE_SITES + given - 1];
+	__atomic_fetch_add(&counts->calls, 1, __ATOMIC_RELAXED);
+	if (bytes == 0)
+		__atomic_fetch_add(&counts->suppressed, 1, __ATOMIC_RELAXED);
+	else
+		__atomic_fetch_add(&counts->bytes, bytes, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&counts->ticks, ticks, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Counters of a statement, every shard summed
+ */
+struct debug_profile_total
+{
+	unsigned slot;
+	struct debug_profile_counts counts;
+};
+
+DEBUG_INTERNAL int debug_profile_costlier(const void *a, const void *b)
+{
+	uint64_t x = ((const struct debug_profile_total *)a)->counts.ticks;
+	uint64_t y = ((const struct debug_profile_total *)b)->counts.ticks;
+
+	return x < y ? 1 : x > y ? -1 : 0;
+}
+
+/**
+ * @brief A line of the report, as text or structured
+ * @return Bytes written
+ */
+DEBUG_INTERNAL size_t debug_profile_line(char *out, size_t size, unsigned rank, const struct debug_profile_total *total, uint64_t mult)
+{
+	const struct debug_profile_site *site = &debug_profile.sites[total->slot];
+	const struct debug_profile_counts *c = &total->counts;
+	const char *level = debug_level_name(site->level) != NULL ? debug_level_name(site->level) : "-";
+	struct debug_writer w;
+	char time[16];
+	int n;
+
+	if (!debug_structured())
+	{
+		debug_timer_duration(time, sizeof(time), debug_timer_ns(c->ticks, mult));
+		n = snprintf(out, size, "%4u %12s %12llu %12llu %12llu  %-7s %s:%u %s\n", rank, time, (unsigned long long)c->calls, (unsigned long long)c->suppressed, (unsigned long long)c->bytes, level, site->file, site->line, site->func);
+		return n < 0 ? 0 : (size_t)n >= size ? size - 1 : (size_t)n;
+	}
+	debug_writer_init(&w, out, size, debug_format.mode);
+	debug_writer_head(&w, site->level, site->file, site->func, site->line);
+	debug_writer_key(&w, "msg");
+	debug_writer_quoted(&w, "profile", 7);
+	debug_writer_key(&w, "rank");
+	debug_writer_uint(&w, rank);
+	debug_writer_key(&w, "calls");
+	debug_writer_uint(&w, c->calls);
+	debug_writer_key(&w, "suppressed");
+	debug_writer_uint(&w, c->suppressed);
+	debug_writer_key(&w, "bytes");
+	debug_writer_uint(&w, c->bytes);
+	debug_writer_key(&w, "ns");
+	debug_writer_uint(&w, debug_timer_ns(c->ticks, mult));
+	debug_writer_end(&w);
+	return w.p - out;
+}
+
+/**
+ * @brief Print the DEBUG_PROFILE costliest statements, by time in formatting and output
+ * @details At exit, and on demand. The counters keep going.
+ */
+DEBUG_INTERNAL void debug_profile_report(void)
+{
+	unsigned used = __atomic_load_n(&debug_profile.used, __ATOMIC_ACQUIRE);
+	struct debug_profile_total *totals;
+	unsigned count = 0;
+	uint64_t mult;
+	char line[1024];
+	size_t n;
+
+	if (!debug_profile_on())
+		return;
+	used = used < DEBUG_PROFILE_SITES ? used : DEBUG_PROFILE_SITES;
+	totals = (struct debug_profile_total *)calloc(used + 1, sizeof(*totals));
+	if (totals == NULL)
+		return;
+	for (unsigned slot = 0; slot < used; ++slot)
+	{
+		struct debug_profile_total *t = &totals[count];
+
+		t->slot = slot;
+		for (unsigned shard = 0; shard < DEBUG_PROFILE_SHARDS; ++shard)
+		{
+			const struct debug_profile_counts *c = &debug_profile.counts[(size_t)shard * DEBUG_PROFILE_SITES + slot];
+
+			t->counts.calls += __atomic_load_n(&c->calls, __ATOMIC_RELAXED);
+			t->counts.suppressed += __atomic_load_n(&c->suppressed, __ATOMIC_RELAXED);
+			t->counts.bytes += __atomic_load_n(&c->bytes, __ATOMIC_RELAXED);
+			t->counts.ticks += __atomic_load_n(&c->ticks, __ATOMIC_RELAXED);
+		}
+		count += t->counts.calls != 0;
+	}
+	qsort(totals, count, sizeof(*totals), debug_profile_costlier);
+	mult = debug_timer_mult();
+	if (!debug_structured())
+	{
+		n = snprintf(line, sizeof(line), "profile: %u statements, the %u costliest\n%4s %12s %12s %12s %12s  %-7s %s\n", count, count < debug_profile.top ? count : debug_profile.top, "", "time", "calls", "suppressed", "bytes", "level", "statement");
+		debug_output(DEBUG_OUT, LOG_INFO, line, n);
+	}
+	for (unsigned i = 0; i < count && i < debug_profile.top; ++i)
+	{
+		n = debug_profile_line(line, sizeof(line), i + 1, &totals[i], mult);
+		debug_output(DEBUG_OUT, LOG_INFO, line, n);
+	}
+	free(totals);
+}
+#else
+DEBUG_INTERNAL void debug_profile_begin(struct debug_profile_call *call);
+DEBUG_INTERNAL void debug_profile_end(unsigned *slot, int level, const char *file, const char *func, unsigned line, const struct debug_profile_call *call);
+DEBUG_INTERNAL void debug_profile_report(void);
+#endif // DEBUG_DEFINITIONS
+
+#endif // DEBUG_PROFILE_H
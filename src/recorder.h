@@ -0,0 +1,349 @@
+/*******************************************************************************
+ * @file		recorder.h
+ * @brief		Flight recorder: every statement, filtered or not, kept in
+ *				per-thread rings of a memory-mapped file
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_RECORDER_H
+#define DEBUG_RECORDER_H
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "stamp.h"
+
+/*
+ * File layout, native byte order:
+ *  header  struct debug_recorder_header, DEBUG_RECORDER_HEADER bytes
+ *  sites   site definitions of the binary output, sites_size bytes
+ *  rings   rings of ring_size bytes, each a struct debug_recorder_ring then its data
+ * A ring holds the records of one thread, as the binary output encodes
+ * them, between tail and head. 'P' pads the end of the data when a record
+ * does not fit, a crash marker is 'C', i32 signal, u64 monotonic (ns).
+ */
+#define DEBUG_RECORDER_MAGIC "DBGREC1\n"
+#define DEBUG_RECORDER_HEADER 4096
+
+#ifndef DEBUG_RECORDER_SITES
+#define DEBUG_RECORDER_SITES (1 << 20) // Bytes for the site definitions
+#endif // DEBUG_RECORDER_SITES
+
+#ifndef DEBUG_RECORDER_STRING
+#define DEBUG_RECORDER_STRING 256 // Longer strings are truncated
+#endif // DEBUG_RECORDER_STRING
+
+#define DEBUG_RECORDER_RING 65536 // Default of DEBUG_RECORDER_SIZE
+#define DEBUG_RECORDER_RINGS 64	  // Default of DEBUG_RECORDER_THREADS
+
+#define DEBUG_RECORDER_CRASH 13 // Size of a crash marker
+
+struct debug_recorder_header
+{
+	char magic[8];
+	int64_t offset; // realtime - monotonic (ns)
+	uint32_t sites_size;
+	uint32_t sites_len;
+	uint32_t ring_size;
+	uint32_t rings;
+	uint32_t rings_used;
+	int32_t crash_signal; // 0 until a crash
+	uint64_t crash_time;
+};
+
+struct debug_recorder_ring
+{
+	uint64_t head; // Where the next record goes, in bytes since the start
+	uint64_t tail; // Oldest record kept
+	uint32_t tid;
+	uint32_t size; // Of data
+	char pad[40];
+};
+
+struct debug_recorder
+{
+	int configured;
+	char *map; // NULL when off
+	size_t map_size;
+	pthread_mutex_t lock;
+	pthread_key_t key;
+	uint32_t *released; // Rings given back by threads which ended, oldest first
+	uint32_t released_first;
+	uint32_t released_count;
+	struct sigaction previous[2]; // SIGSEGV, SIGABRT
+};
+
+DEBUG_SHARED struct debug_recorder debug_recorder;
+DEBUG_SHARED __thread struct debug_recorder_ring *debug_recorder_ring;
+
+#define DEBUG_RECORDER_NONE ((struct debug_recorder_ring *)1) // No ring left for the thread
+
+#define debug_recorder_on() \
+	__builtin_expect(debug_recorder.map != NULL, 0)
+
+#if DEBUG_DEFINITIONS
+DEBUG_INTERNAL struct debug_recorder_header *debug_recorder_header(void)
+{
+	return (struct debug_recorder_header *)debug_recorder.map;
+}
+
+DEBUG_INTERNAL struct debug_recorder_ring *debug_recorder_at(uint32_t index)
+{
+	struct debug_recorder_header *header = debug_recorder_header();
+
+	return (struct debug_recorder_ring *)(debug_recorder.map + DEBUG_RECORDER_HEADER + header->sites_size + (size_t)index * header->ring_size);
+}
+
+/**
+ * @brief A thread ends, give its ring back
+ */
+DEBUG_INTERNAL void debug_recorder_release(void *arg)
+{
+	struct debug_recorder_ring *ring = (struct debug_recorder_ring *)arg;
+	struct debug_recorder_header *header = debug_recorder_header();
+
+	pthread_mutex_lock(&debug_recorder.lock);
+	debug_recorder.released[(debug_recorder.released_first + debug_recorder.released_count++) % header->rings] = ((char *)ring - (char *)debug_recorder_at(0)) / header->ring_size;
+	pthread_mutex_unlock(&debug_recorder.lock);
+	debug_recorder_ring = DEBUG_RECORDER_NONE; // Statements of later destructors
+}
+
+/**
+ * @brief Ring of the thread, claimed the first time
+ * @return NULL once every ring is taken
+ * @details Unused rings first, then the ones of threads which ended longest
+ * ago, whose records are dropped. A thread left without a ring does not ask
+ * again.
+ */
+DEBUG_INTERNAL DEBUG_COLD struct debug_recorder_ring *debug_recorder_take(void)
+{
+	struct debug_recorder_header *header = debug_recorder_header();
+	struct debug_recorder_ring *ring;
+	uint32_t index = __atomic_load_n(&header->rings_used, __ATOMIC_RELAXED);
+
+	do
+	{
+		if (index >= header->rings)
+			break;
+	} while (!__atomic_compare_exchange_n(&header->rings_used, &index, index + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	if (index < header->rings)
+	{
+		ring = debug_recorder_at(index);
+		ring->size = header->ring_size - sizeof(*ring);
+	}
+	else
+	{
+		ring = NULL;
+		pthread_mutex_lock(&debug_recorder.lock);
+		if (debug_recorder.released_count != 0)
+		{
+			ring = debug_recorder_at(debug_recorder.released[debug_recorder.released_first]);
+			debug_recorder.released_first = (debug_recorder.released_first + 1) % header->rings;
+			--debug_recorder.released_count;
+		}
+		pthread_mutex_unlock(&debug_recorder.lock);
+		if (ring == NULL)
+		{
+			debug_recorder_ring = DEBUG_RECORDER_NONE;
+			return NULL;
+		}
+		__atomic_store_n(&ring->tail, ring->head, __ATOMIC_RELEASE);
+	}
+	ring->tid = debug_thread_id();
+	pthread_setspecific(debug_recorder.key, ring);
+	debug_recorder_ring = ring;
+	return ring;
+}
+
+DEBUG_INTERNAL struct debug_recorder_ring *debug_recorder_claim(void)
+{
+	struct debug_recorder_ring *ring = debug_recorder_ring;
+
+	if (__builtin_expect(ring != NULL, 1))
+		return ring != DEBUG_RECORDER_NONE ? ring : NULL;
+	return debug_recorder_take();
+}
+
+/**
+ * @brief Size of the entry at pos, to drop it
+ */
+DEBUG_INTERNAL uint64_t debug_recorder_entry(const struct debug_recorder_ring *ring, uint64_t pos)
+{
+	const char *data = (const char *)(ring + 1);
+	uint64_t off = pos % ring->size;
+	uint32_t size;
+
+	switch (data[off])
+	{
+	case 'R':
+		memcpy(&size, data + off + 13, 4);
+		return 17 + size;
+	case 'C':
+		return DEBUG_RECORDER_CRASH;
+	default: // 'P'
+		return ring->size - off;
+	}
+}
+
+/**
+ * @brief Append an entry to ring, dropping the oldest ones
+ * @details Only the thread writes to its ring. head is stored last, so that
+ * an entry being written when the process dies is ignored.
+ */
+DEBUG_INTERNAL void debug_recorder_put(struct debug_recorder_ring *ring, const char *entry, size_t len)
+{
+	char *data;
+	uint64_t head;
+	uint64_t off;
+	uint64_t need;
+
+	if (ring == NULL || len > ring->size / 2)
+		return;
+	data = (char *)(ring + 1);
+	head = ring->head;
+	off = head % ring->size;
+	need = off + len > ring->size ? ring->size - off + len : len;
+
+	while (head + need - ring->tail > ring->size)
+		__atomic_store_n(&ring->tail, ring->tail + debug_recorder_entry(ring, ring->tail), __ATOMIC_RELEASE);
+	if (need != len)
+	{
+		data[off] = 'P';
+		head += ring->size - off;
+		off = 0;
+	}
+	memcpy(data + off, entry, len);
+	__atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Append an entry to the ring of the thread, claimed at its first one
+ */
+DEBUG_INTERNAL void debug_recorder_append(const char *entry, size_t len)
+{
+	debug_recorder_put(debug_recorder_claim(), entry, len);
+}
+
+/**
+ * @brief Keep a site definition (see binary.h)
+ */
+DEBUG_INTERNAL void debug_recorder_define(const char *def, size_t size)
+{
+	struct debug_recorder_header *header = debug_recorder_header();
+
+	if (header->sites_len + size > header->sites_size)
+		return;
+	memcpy(debug_recorder.map + DEBUG_RECORDER_HEADER + header->sites_len, def, size);
+	__atomic_store_n(&header->sites_len, header->sites_len + size, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Mark the crash in the file and in the ring of the thread, then
+ * let the previous handler, or the default action, take place
+ * @details A thread without a ring is not given one: taking one locks, which
+ * a signal handler must not do.
+ */
+DEBUG_INTERNAL void debug_recorder_crash(int sig)
+{
+	struct debug_recorder_header *header = debug_recorder_header();
+	struct debug_recorder_ring *ring = debug_recorder_ring;
+	uint64_t now = debug_clock_now(1);
+	char marker[DEBUG_RECORDER_CRASH];
+	int32_t s = sig;
+
+	marker[0] = 'C';
+	memcpy(marker + 1, &s, 4);
+	memcpy(marker + 5, &now, 8);
+	if (ring != NULL && ring != DEBUG_RECORDER_NONE)
+		debug_recorder_put(ring, marker, sizeof(marker));
+	header->crash_time = now;
+	__atomic_store_n(&header->crash_signal, s, __ATOMIC_RELEASE);
+
+	sigaction(sig, &debug_recorder.previous[sig == SIGABRT], NULL);
+	raise(sig);
+}
+
+/**
+ * @brief Map the file given by DEBUG_RECORDER
+ * @details DEBUG_RECORDER_SIZE bytes per thread (64 KiB), DEBUG_RECORDER_THREADS rings (64).
+ */
+DEBUG_INTERNAL void debug_recorder_env(void)
+{
+	const char *path = getenv("DEBUG_RECORDER");
+	const char *ring_size = getenv("DEBUG_RECORDER_SIZE");
+	const char *rings = getenv("DEBUG_RECORDER_THREADS");
+	struct debug_recorder_header header;
+	struct sigaction action;
+	char *map;
+	int fd;
+
+	if (__atomic_exchange_n(&debug_recorder.configured, 1, __ATOMIC_ACQ_REL))
+		return;
+	if (path == NULL || path[0] == '\0')
+		return;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, DEBUG_RECORDER_MAGIC, sizeof(header.magic));
+	header.sites_size = DEBUG_RECORDER_SITES;
+	header.ring_size = ring_size != NULL ? strtoul(ring_size, NULL, 0) : DEBUG_RECORDER_RING;
+	header.rings = rings != NULL ? strtoul(rings, NULL, 0) : DEBUG_RECORDER_RINGS;
+	if (header.ring_size < 4096)
+		header.ring_size = 4096;
+	header.ring_size &= ~63U;
+	header.offset = (int64_t)debug_clock_read(CLOCK_REALTIME) - (int64_t)debug_clock_now(1);
+
+	debug_recorder.map_size = DEBUG_RECORDER_HEADER + header.sites_size + (size_t)header.rings * header.ring_size;
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0 || ftruncate(fd, debug_recorder.map_size) != 0)
+	{
+		perror("DEBUG_RECORDER");
+		if (fd >= 0)
+			close(fd);
+		return;
+	}
+	map = (char *)mmap(NULL, debug_recorder.map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		perror("DEBUG_RECORDER");
+		return;
+	}
+	memcpy(map, &header, sizeof(header));
+	pthread_mutex_init(&debug_recorder.lock, NULL);
+	debug_recorder.released = (uint32_t *)calloc(header.rings, sizeof(uint32_t));
+	if (debug_recorder.released == NULL || pthread_key_create(&debug_recorder.key, debug_recorder_release) != 0)
+	{
+		free(debug_recorder.released);
+		munmap(map, debug_recorder.map_size);
+		return;
+	}
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = debug_recorder_crash;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGSEGV, &action, &debug_recorder.previous[0]);
+	sigaction(SIGABRT, &action, &debug_recorder.previous[1]);
+	__atomic_store_n(&debug_recorder.map, map, __ATOMIC_RELEASE);
+}
+#else
+DEBUG_INTERNAL void debug_recorder_append(const char *entry, size_t len);
+#endif // DEBUG_DEFINITIONS
+
+#endif // DEBUG_RECORDER_H
@@ -0,0 +1,426 @@
+/*******************************************************************************
+ * @file		sink.h
+ * @brief		Destinations of the records, each with its own level
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_SINK_H
+#define DEBUG_SINK_H
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "async.h"
+
+#ifndef DEBUG_SINKS
+#define DEBUG_SINKS 8
+#endif // DEBUG_SINKS
+
+#ifndef DEBUG_SINK_BUFFER
+#define DEBUG_SINK_BUFFER 65536 // Of file sinks
+#endif // DEBUG_SINK_BUFFER
+
+enum debug_sink_type
+{
+	DEBUG_SINK_FD,	   // Written at once, or queued in async mode
+	DEBUG_SINK_FILE,   // Buffered
+	DEBUG_SINK_ROTATE, // Buffered, renamed to path.1, path.2... past a size or an age
+	DEBUG_SINK_MEMORY, // Kept in memory, for tests
+};
+
+struct debug_sink
+{
+	enum debug_sink_type type;
+	int level; // Highest loglevel written, records without level always are
+	int fd;
+	pthread_mutex_t lock;
+	char *data; // Buffer of file sinks, content of memory sinks
+	size_t len;
+	size_t size;
+	unsigned long dropped; // Records which did not fit in a memory sink
+	char *path;
+	size_t max_size; // Rotation, 0 for none
+	size_t written;
+	time_t period; // Rotation, 0 for none
+	time_t opened;
+	int keep; // Rotated files kept
+};
+
+/**
+ * @brief Sinks in use, none writes to the fd of the statement
+ * @details Records are formatted once, then written to every sink whose level passes.
+ */
+struct debug_sinks
+{
+	int count;
+	int max_level; // Highest level of all sinks
+	int flush_at_exit;
+	pthread_mutex_t lock;
+	struct debug_sink *sinks[DEBUG_SINKS];
+};
+
+DEBUG_SHARED struct debug_sinks debug_sinks = {0, LOG_NONE, 0, PTHREAD_MUTEX_INITIALIZER, {0}};
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief Whether a record of this level goes anywhere, before formatting it
+ */
+DEBUG_INTERNAL int debug_sinks_accept(int level)
+{
+	return __atomic_load_n(&debug_sinks.count, __ATOMIC_ACQUIRE) == 0 || level == LOG_UNDEFINED || level <= __atomic_load_n(&debug_sinks.max_level, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Write to a file descriptor
+ * @details Queued for the writer thread in async mode, otherwise written
+ * at once: a single fwrite() for the standard streams, so that records
+ * stay in order with the rest of the program output.
+ */
+DEBUG_INTERNAL void debug_output_fd(int fd, const char *buf, size_t len)
+{
+	FILE *stream;
+
+	if (debug_async_write(fd, buf, len) == 0)
+		return;
+	// Too long for the ring, keep its place
+	debug_async_flush();
+
+	stream = fd == STDOUT_FILENO ? stdout : fd == STDERR_FILENO ? stderr : NULL;
+	if (stream != NULL)
+		fwrite(buf, 1, len, stream);
+	else
+		debug_write(fd, buf, len);
+}
+
+/**
+ * @brief Write the buffer of a file sink, its lock held
+ */
+DEBUG_INTERNAL void debug_sink_drain(struct debug_sink *sink)
+{
+	if (sink->type == DEBUG_SINK_MEMORY || sink->len == 0)
+		return;
+	debug_write(sink->fd, sink->data, sink->len);
+	sink->len = 0;
+}
+
+/**
+ * @brief Rename path to path.1, path.1 to path.2... and start a new file
+ */
+DEBUG_INTERNAL void debug_sink_rotate_now(struct debug_sink *sink)
+{
+	char from[4096 + 16];
+	char to[4096 + 16];
+
+	debug_sink_drain(sink);
+	close(sink->fd);
+	for (int i = sink->keep - 1; i >= 1; --i)
+	{
+		snprintf(from, sizeof(from), "%s.%d", sink->path, i);
+		snprintf(to, sizeof(to), "%s.%d", sink->path, i + 1);
+		rename(from, to);
+	}
+	if (sink->keep > 0)
+	{
+		snprintf(to, sizeof(to), "%s.1", sink->path);
+		rename(sink->path, to);
+	}
+	sink->fd = open(sink->path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+	sink->written = 0;
+	sink->opened = time(NULL);
+}
+
+/**
+ * @brief Write a record to a sink, whatever its level
+ */
+DEBUG_INTERNAL void debug_sink_write(struct debug_sink *sink, int level, const char *buf, size_t len)
+{
+	if (sink->type == DEBUG_SINK_FD)
+	{
+		debug_output_fd(sink->fd, buf, len);
+		return;
+	}
+
+	pthread_mutex_lock(&sink->lock);
+	switch (sink->type)
+	{
+	case DEBUG_SINK_MEMORY:
+		if (len > sink->size - sink->len)
+			++sink->dropped;
+		else
+		{
+			memcpy(sink->data + sink->len, buf, len);
+			sink->len += len;
+		}
+		break;
+	case DEBUG_SINK_ROTATE:
+		if ((sink->max_size != 0 && sink->written != 0 && sink->written + len > sink->max_size) || (sink->period != 0 && time(NULL) >= sink->opened + sink->period))
+			debug_sink_rotate_now(sink);
+		sink->written += len;
+		__attribute__((fallthrough));
+	default:
+		if (len > sink->size - sink->len)
+			debug_sink_drain(sink);
+		if (len >= sink->size)
+			debug_write(sink->fd, buf, len);
+		else
+		{
+			memcpy(sink->data + sink->len, buf, len);
+			sink->len += len;
+		}
+		// What comes next may well be a crash
+		if (level == LOG_FATAL)
+			debug_sink_drain(sink);
+		break;
+	}
+	pthread_mutex_unlock(&sink->lock);
+}
+
+/**
+ * @brief Write a formatted record to every sink whose level passes
+ */
+DEBUG_INTERNAL void debug_sinks_write(int level, const char *buf, size_t len)
+{
+	for (int i = 0; i < DEBUG_SINKS; ++i)
+	{
+		struct debug_sink *sink = __atomic_load_n(&debug_sinks.sinks[i], __ATOMIC_ACQUIRE);
+
+		if (sink != NULL && (level == LOG_UNDEFINED || level <= sink->level))
+			debug_sink_write(sink, level, buf, len);
+	}
+}
+
+/**
+ * @brief Write what the file sinks hold
+ */
+DEBUG_INTERNAL void debug_sinks_flush(void)
+{
+	pthread_mutex_lock(&debug_sinks.lock);
+	for (int i = 0; i < DEBUG_SINKS; ++i)
+	{
+		struct debug_sink *sink = debug_sinks.sinks[i];
+
+		if (sink == NULL)
+			continue;
+		pthread_mutex_lock(&sink->lock);
+		debug_sink_drain(sink);
+		pthread_mutex_unlock(&sink->lock);
+	}
+	pthread_mutex_unlock(&debug_sinks.lock);
+}
+
+/**
+ * @brief Recompute count and max_level, debug_sinks.lock held
+ */
+DEBUG_INTERNAL void debug_sinks_update(void)
+{
+	int count = 0;
+	int max_level = LOG_NONE;
+
+	for (int i = 0; i < DEBUG_SINKS; ++i)
+	{
+		if (debug_sinks.sinks[i] == NULL)
+			continue;
+		++count;
+		if (debug_sinks.sinks[i]->level > max_level)
+			max_level = debug_sinks.sinks[i]->level;
+	}
+	__atomic_store_n(&debug_sinks.max_level, max_level, __ATOMIC_RELAXED);
+	__atomic_store_n(&debug_sinks.count, count, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Start writing to a sink
+ * @return sink, NULL when there are already DEBUG_SINKS (sink is freed)
+ */
+DEBUG_INTERNAL struct debug_sink *debug_sink_add(struct debug_sink *sink)
+{
+	int added = 0;
+
+	pthread_mutex_lock(&debug_sinks.lock);
+	for (int i = 0; i < DEBUG_SINKS && !added; ++i)
+	{
+		if (debug_sinks.sinks[i] != NULL)
+			continue;
+		__atomic_store_n(&debug_sinks.sinks[i], sink, __ATOMIC_RELEASE);
+		added = 1;
+	}
+	if (added && !debug_sinks.flush_at_exit)
+	{
+		debug_sinks.flush_at_exit = 1;
+		atexit(debug_sinks_flush);
+	}
+	debug_sinks_update();
+	pthread_mutex_unlock(&debug_sinks.lock);
+	if (added)
+		return sink;
+	if (sink->type != DEBUG_SINK_FD && sink->fd >= 0)
+		close(sink->fd);
+	free(sink->data);
+	free(sink->path);
+	free(sink);
+	return NULL;
+}
+
+DEBUG_INTERNAL struct debug_sink *debug_sink_new(enum debug_sink_type type, int level, int fd, size_t size)
+{
+	struct debug_sink *sink = (struct debug_sink *)calloc(1, sizeof(struct debug_sink));
+
+	if (sink == NULL)
+		return NULL;
+	sink->type = type;
+	sink->level = level;
+	sink->fd = fd;
+	sink->size = size;
+	pthread_mutex_init(&sink->lock, NULL);
+	if (size != 0 && (sink->data = (char *)malloc(size)) == NULL)
+	{
+		free(sink);
+		return NULL;
+	}
+	return sink;
+}
+
+/**
+ * @brief Records up to level to a file descriptor, not closed by the sink
+ * @return NULL on failure
+ */
+DEBUG_INTERNAL struct debug_sink *debug_sink_fd(int fd, int level)
+{
+	struct debug_sink *sink = debug_sink_new(DEBUG_SINK_FD, level, fd, 0);
+
+	return sink != NULL ? debug_sink_add(sink) : NULL;
+}
+
+/**
+ * @brief Records up to level appended to a file, buffered
+ * @details The buffer is written when full, after a LOG_FATAL record, by
+ * debug_sinks_flush() and at exit.
+ */
+DEBUG_INTERNAL struct debug_sink *debug_sink_file(const char *path, int level)
+{
+	int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	struct debug_sink *sink;
+
+	if (fd < 0)
+		return NULL;
+	sink = debug_sink_new(DEBUG_SINK_FILE, level, fd, DEBUG_SINK_BUFFER);
+	if (sink == NULL)
+	{
+		close(fd);
+		return NULL;
+	}
+	return debug_sink_add(sink);
+}
+
+/**
+ * @brief Records up to level to a file, rotated
+ * @param max_size Rotate before exceeding it, 0 for no limit
+ * @param period Rotate after as many seconds, 0 for no limit
+ * @param keep How many old files, path.1 being the newest
+ */
+DEBUG_INTERNAL struct debug_sink *debug_sink_rotate(const char *path, int level, size_t max_size, unsigned period, int keep)
+{
+	struct debug_sink *sink = debug_sink_file(path, level);
+	struct stat st;
+
+	if (sink == NULL)
+		return NULL;
+	pthread_mutex_lock(&sink->lock);
+	sink->path = strdup(path);
+	sink->max_size = max_size;
+	sink->period = period;
+	sink->keep = keep;
+	sink->opened = time(NULL);
+	sink->written = fstat(sink->fd, &st) == 0 ? st.st_size : 0;
+	if (sink->path != NULL)
+		sink->type = DEBUG_SINK_ROTATE;
+	pthread_mutex_unlock(&sink->lock);
+	return sink;
+}
+
+/**
+ * @brief Records up to level kept in memory, up to size bytes
+ * @details Records which do not fit are dropped, see debug_sink_memory_clear().
+ */
+DEBUG_INTERNAL struct debug_sink *debug_sink_memory(size_t size, int level)
+{
+	struct debug_sink *sink = debug_sink_new(DEBUG_SINK_MEMORY, level, -1, size);
+
+	return sink != NULL ? debug_sink_add(sink) : NULL;
+}
+
+/**
+ * @brief Copy what a memory sink holds
+ * @return Its length, at most size bytes copied
+ */
+DEBUG_INTERNAL size_t debug_sink_memory_read(struct debug_sink *sink, char *buf, size_t size)
+{
+	size_t len;
+
+	pthread_mutex_lock(&sink->lock);
+	len = sink->len;
+	memcpy(buf, sink->data, len < size ? len : size);
+	pthread_mutex_unlock(&sink->lock);
+	return len;
+}
+
+DEBUG_INTERNAL void debug_sink_memory_clear(struct debug_sink *sink)
+{
+	pthread_mutex_lock(&sink->lock);
+	sink->len = 0;
+	sink->dropped = 0;
+	pthread_mutex_unlock(&sink->lock);
+}
+
+/**
+ * @brief Stop writing to a sink, flush and free it
+ * @details No other thread may be logging at the same time.
+ */
+DEBUG_INTERNAL void debug_sink_remove(struct debug_sink *sink)
+{
+	pthread_mutex_lock(&debug_sinks.lock);
+	for (int i = 0; i < DEBUG_SINKS; ++i)
+	{
+		if (debug_sinks.sinks[i] == sink)
+			__atomic_store_n(&debug_sinks.sinks[i], NULL, __ATOMIC_RELEASE);
+	}
+	debug_sinks_update();
+	pthread_mutex_unlock(&debug_sinks.lock);
+
+	debug_sink_drain(sink);
+	if (sink->type != DEBUG_SINK_FD && sink->fd >= 0)
+		close(sink->fd);
+	pthread_mutex_destroy(&sink->lock);
+	free(sink->data);
+	free(sink->path);
+	free(sink);
+}
+#else
+DEBUG_INTERNAL int debug_sinks_accept(int level);
+DEBUG_INTERNAL void debug_sinks_flush(void);
+DEBUG_INTERNAL struct debug_sink *debug_sink_fd(int fd, int level);
+DEBUG_INTERNAL struct debug_sink *debug_sink_file(const char *path, int level);
+DEBUG_INTERNAL struct debug_sink *debug_sink_rotate(const char *path, int level, size_t max_size, unsigned period, int keep);
+DEBUG_INTERNAL struct debug_sink *debug_sink_memory(size_t size, int level);
+DEBUG_INTERNAL size_t debug_sink_memory_read(struct debug_sink *sink, char *buf, size_t size);
+DEBUG_INTERNAL void debug_sink_memory_clear(struct debug_sink *sink);
+DEBUG_INTERNAL void debug_sink_remove(struct debug_sink *sink);
+#endif // DEBUG_DEFINITIONS
+
+#endif // DEBUG_SINK_H
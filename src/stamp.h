@@ -0,0 +1,239 @@
+/*******************************************************************************
+ * @file		stamp.h
+ * @brief		Optional fields of the record prefix: wall clock time, thread id
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_STAMP_H
+#define DEBUG_STAMP_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif // __x86_64__
+
+#include "common.h"
+
+/** Fields of DEBUG_PREFIX */
+#define DEBUG_PREFIX_TIME 1 // "2026-10-17 22:23:53.079009 "
+#define DEBUG_PREFIX_TID 2	// "[9702] "
+
+#define DEBUG_PREFIX_SIZE 48 // Of every field together, at most
+
+/** Source of the timestamps, see DEBUG_CLOCK */
+#define DEBUG_CLOCK_COARSE 0	// CLOCK_MONOTONIC_COARSE, a tick of resolution
+#define DEBUG_CLOCK_MONOTONIC 1 // CLOCK_MONOTONIC
+#define DEBUG_CLOCK_TSC 2		// Time stamp counter, calibrated against CLOCK_MONOTONIC
+
+struct debug_clock
+{
+	int configured;
+	int fields; // DEBUG_PREFIX_*
+	int source; // DEBUG_CLOCK_*
+	int64_t offset; // realtime - monotonic (ns), refreshed every minute
+	uint64_t tsc;	// Calibration: tsc at monotonic ns
+	uint64_t ns;
+	uint64_t mult; // ns per cycle << 32
+};
+
+/**
+ * @brief What a thread formatted last
+ */
+struct debug_stamp
+{
+	int64_t second; // Of time, 0 before the first record
+	int64_t minute;
+	char time[28];
+	char tid[16];
+	unsigned tid_len;
+};
+
+DEBUG_SHARED struct debug_clock debug_clock = {0, 0, DEBUG_CLOCK_COARSE, 0, 0, 0, 0};
+DEBUG_SHARED __thread struct debug_stamp debug_stamp;
+DEBUG_SHARED __thread pid_t debug_tid;
+
+#if DEBUG_DEFINITIONS
+/**
+ * @brief Id of the calling thread, asked to the kernel once
+ */
+DEBUG_INTERNAL pid_t debug_thread_id(void)
+{
+	if (__builtin_expect(debug_tid == 0, 0))
+		debug_tid = syscall(SYS_gettid);
+	return debug_tid;
+}
+
+DEBUG_INTERNAL uint64_t debug_clock_read(clockid_t id)
+{
+	struct timespec ts;
+
+	clock_gettime(id, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Monotonic time (ns), from the DEBUG_CLOCK source
+ * @param precise Whether a tick of resolution is too coarse
+ */
+DEBUG_INTERNAL uint64_t debug_clock_now(int precise)
+{
+#if defined(__x86_64__)
+	if (debug_clock.source == DEBUG_CLOCK_TSC)
+		return debug_clock.ns + (uint64_t)(((unsigned __int128)(__rdtsc() - debug_clock.tsc) * debug_clock.mult) >> 32);
+#endif // __x86_64__
+	return debug_clock_read(debug_clock.source == DEBUG_CLOCK_COARSE && !precise ? CLOCK_MONOTONIC_COARSE : CLOCK_MONOTONIC);
+}
+
+/**
+ * @brief realtime - monotonic, with clocks of the same resolution
+ */
+DEBUG_INTERNAL int64_t debug_clock_offset(void)
+{
+	if (debug_clock.source == DEBUG_CLOCK_COARSE)
+		return (int64_t)debug_clock_read(CLOCK_REALTIME_COARSE) - (int64_t)debug_clock_read(CLOCK_MONOTONIC_COARSE);
+	return (int64_t)debug_clock_read(CLOCK_REALTIME) - (int64_t)debug_clock_now(1);
+}
+
+/**
+ * @brief Count cycles during 10 ms, when the counter is invariant
+ * @return Whether the TSC may be used
+ */
+DEBUG_INTERNAL int debug_clock_calibrate(void)
+{
+#if defined(__x86_64__)
+	unsigned a, b, c, d;
+	uint64_t tsc;
+	uint64_t ns;
+
+	if (!__get_cpuid(0x80000007, &a, &b, &c, &d) || !(d & (1U << 8)))
+		return 0;
+	debug_clock.ns = debug_clock_read(CLOCK_MONOTONIC);
+	debug_clock.tsc = __rdtsc();
+	do
+	{
+		ns = debug_clock_read(CLOCK_MONOTONIC);
+		tsc = __rdtsc();
+	} while (ns - debug_clock.ns < 10000000);
+	if (tsc <= debug_clock.tsc)
+		return 0;
+	debug_clock.mult = ((ns - debug_clock.ns) << 32) / (tsc - debug_clock.tsc);
+	return 1;
+#else
+	return 0;
+#endif // __x86_64__
+}
+
+/**
+ * @brief Read DEBUG_PREFIX=time,tid and DEBUG_CLOCK=coarse|monotonic|tsc
+ * @details coarse, the default, reads CLOCK_MONOTONIC_COARSE: a few ns, a tick
+ * of resolution. tsc falls back to monotonic when the counter is not invariant.
+ */
+DEBUG_INTERNAL void debug_clock_env(void)
+{
+	const char *prefix = getenv("DEBUG_PREFIX");
+	const char *source = getenv("DEBUG_CLOCK");
+	int fields = 0;
+
+	if (__atomic_exchange_n(&debug_clock.configured, 1, __ATOMIC_ACQ_REL))
+		return;
+	if (prefix != NULL)
+		fields = (strstr(prefix, "time") != NULL ? DEBUG_PREFIX_TIME : 0) | (strstr(prefix, "tid") != NULL ? DEBUG_PREFIX_TID : 0);
+	if (source != NULL && strcmp(source, "monotonic") == 0)
+		debug_clock.source = DEBUG_CLOCK_MONOTONIC;
+	else if (source != NULL && strcmp(source, "tsc") == 0)
+		debug_clock.source = debug_clock_calibrate() ? DEBUG_CLOCK_TSC : DEBUG_CLOCK_MONOTONIC;
+	__atomic_store_n(&debug_clock.offset, debug_clock_offset(), __ATOMIC_RELAXED);
+	__atomic_store_n(&debug_clock.fields, fields, __ATOMIC_RELAXED);
+}
+
+DEBUG_INTERNAL void debug_stamp_digits(char *p, unsigned value, int n)
+{
+	while (n-- > 0)
+	{
+		p[n] = '0' + value % 10;
+		value /= 10;
+	}
+}
+
+/**
+ * @brief Wall clock time of the thread's stamp, reformatted from what changed
+ * @details The date is built once a minute, the offset to the wall clock
+ * refreshed then; otherwise only the seconds and microseconds are written.
+ */
+DEBUG_INTERNAL void debug_stamp_time(struct debug_stamp *stamp)
+{
+	uint64_t ns = debug_clock_now(0) + __atomic_load_n(&debug_clock.offset, __ATOMIC_RELAXED);
+	int64_t second = ns / 1000000000;
+
+	if (second != stamp->second)
+	{
+		if (second / 60 != stamp->minute)
+		{
+			time_t t = second;
+			struct tm tm;
+
+			localtime_r(&t, &tm);
+			strftime(stamp->time, sizeof(stamp->time), "%F %T.", &tm);
+			stamp->time[26] = ' ';
+			stamp->minute = second / 60;
+			__atomic_store_n(&debug_clock.offset, debug_clock_offset(), __ATOMIC_RELAXED);
+		}
+		else
+			debug_stamp_digits(stamp->time + 17, second % 60, 2);
+		stamp->second = second;
+	}
+	debug_stamp_digits(stamp->time + 20, ns % 1000000000 / 1000, 6);
+}
+
+/**
+ * @brief Write the fields of DEBUG_PREFIX
+ * @param buf DEBUG_PREFIX_SIZE bytes
+ * @return How many bytes, 0 without fields
+ */
+DEBUG_INTERNAL size_t debug_stamp_write(char *buf)
+{
+	int fields = __atomic_load_n(&debug_clock.fields, __ATOMIC_RELAXED);
+	struct debug_stamp *stamp;
+	size_t len = 0;
+
+	if (__builtin_expect(fields == 0, 1))
+		return 0;
+	stamp = &debug_stamp;
+	if (fields & DEBUG_PREFIX_TIME)
+	{
+		debug_stamp_time(stamp);
+		memcpy(buf, stamp->time, 27);
+		len = 27;
+	}
+	if (fields & DEBUG_PREFIX_TID)
+	{
+		if (__builtin_expect(stamp->tid_len == 0, 0))
+			stamp->tid_len = snprintf(stamp->tid, sizeof(stamp->tid), "[%d] ", (int)debug_thread_id());
+		memcpy(buf + len, stamp->tid, stamp->tid_len);
+		len += stamp->tid_len;
+	}
+	return len;
+}
+#else
+DEBUG_INTERNAL uint64_t debug_clock_read(clockid_t id);
+DEBUG_INTERNAL size_t debug_stamp_write(char *buf);
+#endif // DEBUG_DEFINITIONS
+
+#endif // DEBUG_STAMP_H
@@ -6,13 +6,16 @@
  * 
  * PROJECT:		src
  * 
- * MODIFIED:	Sun Dec 08 2024
+ * MODIFIED:	Sat Oct 17 2026
  * BY:			Dimitri Simon
  * 
  * Copyright (c) 2024 Dimitri Simon
  * 
  *******************************************************************************/
 
+#ifndef DEBUG_TERM_H
+#define DEBUG_TERM_H
+
 /* Legacy */
 
 #define __STRINGIFY(x) #x
@@ -108,3 +111,4 @@
 #define TE_RGB_BG(r,g,b) \
 	"\e[" TE_BG ";2;" #r ";" #g ";" #b "m"
 
+#endif // DEBUG_TERM_H
@@ -0,0 +1,299 @@
+/*******************************************************************************
+ * @file		timer.h
+ * @brief		Scoped latency timers: a histogram per call site, percentiles
+ *				printed at exit or on demand
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#ifndef DEBUG_TIMER_H
+#define DEBUG_TIMER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "common.h"
+#include "fields.h"
+#include "stamp.h"
+
+/*
+ * Log-linear histogram: 16 linear buckets per power of two, a value is
+ * kept within 1/16 (6.25 %). Values from 2^44 ticks on share the last bucket.
+ */
+#define DEBUG_TIMER_SUB 16
+#define DEBUG_TIMER_BUCKETS ((44 - 3) * DEBUG_TIMER_SUB)
+
+#define DEBUG_TIMER_LEVEL LOG_INFO // Of the summaries
+#define DEBUG_TIMER_FIELDS 7	   // Of a structured summary
+
+struct debug_timer
+{
+	const char *file;
+	const char *func;
+	unsigned line;
+	const char *name;
+	void (*report)(const struct debug_timer *); // Prints the summary, as C or C++ does
+	struct debug_timer *next;					// Of debug_timers.head
+	int registered;
+	uint64_t max; // Ticks
+	uint64_t buckets[DEBUG_TIMER_BUCKETS];
+};
+
+/**
+ * @brief Timers which recorded something, reported at exit
+ */
+struct debug_timers
+{
+	int atexit;
+	struct debug_timer *head;
+	uint64_t mult; // ns per tick << 32, 0 until a report
+};
+
+DEBUG_SHARED struct debug_timers debug_timers;
+
+/**
+ * @brief Summary of a timer, in ns
+ */
+struct debug_timer_stats
+{
+	uint64_t count;
+	uint64_t mean;
+	uint64_t p50;
+	uint64_t p99;
+	uint64_t p999;
+	uint64_t max;
+};
+
+/**
+ * @brief Ticks: the time stamp counter on x86-64, CLOCK_MONOTONIC (ns) otherwise
+ */
+DEBUG_LOCAL uint64_t debug_timer_now(void)
+{
+#if defined(__x86_64__)
+	return __rdtsc();
+#else
+	return debug_clock_read(CLOCK_MONOTONIC);
+#endif // __x86_64__
+}
+
+#if DEBUG_DEFINITIONS
+DEBUG_INTERNAL unsigned debug_timer_bucket(uint64_t ticks)
+{
+	unsigned e;
+
+	if (ticks < DEBUG_TIMER_SUB)
+		return ticks;
+	e = 63 - __builtin_clzll(ticks);
+	if (e >= 44)
+		return DEBUG_TIMER_BUCKETS - 1;
+	return (e - 3) * DEBUG_TIMER_SUB + ((ticks >> (e - 4)) & (DEBUG_TIMER_SUB - 1));
+}
+
+/**
+ * @brief Lowest value of a bucket
+ */
+DEBUG_INTERNAL uint64_t debug_timer_lower(unsigned bucket)
+{
+	unsigned e = bucket / DEBUG_TIMER_SUB + 3;
+
+	if (bucket < DEBUG_TIMER_SUB)
+		return bucket;
+	return (uint64_t)(DEBUG_TIMER_SUB + bucket % DEBUG_TIMER_SUB) << (e - 4);
+}
+
+/**
+ * @brief Highest value of a bucket
+ */
+DEBUG_INTERNAL uint64_t debug_timer_upper(unsigned bucket)
+{
+	return bucket + 1 < DEBUG_TIMER_BUCKETS ? debug_timer_lower(bucket + 1) - 1 : UINT64_MAX;
+}
+
+DEBUG_INTERNAL void debug_timers_report(void);
+
+/**
+ * @brief Add the timer to the ones reported, the first time it records
+ */
+DEBUG_INTERNAL void debug_timer_register(struct debug_timer *timer)
+{
+	struct debug_timer *head;
+
+	if (__atomic_exchange_n(&timer->registered, 1, __ATOMIC_ACQ_REL))
+		return;
+	head = __atomic_load_n(&debug_timers.head, __ATOMIC_RELAXED);
+	do
+		timer->next = head;
+	while (!__atomic_compare_exchange_n(&debug_timers.head, &head, timer, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	if (!__atomic_exchange_n(&debug_timers.atexit, 1, __ATOMIC_ACQ_REL))
+		atexit(debug_timers_report);
+}
+
+/**
+ * @brief Keep a duration in the histogram of the timer
+ * @details Lock-free: an increment of its bucket, and the max when it grows.
+ * @param ticks From debug_timer_now()
+ */
+DEBUG_INTERNAL void debug_timer_record(struct debug_timer *timer, uint64_t ticks)
+{
+	uint64_t max = __atomic_load_n(&timer->max, __ATOMIC_RELAXED);
+
+	if (__builtin_expect(!__atomic_load_n(&timer->registered, __ATOMIC_RELAXED), 0))
+		debug_timer_register(timer);
+	__atomic_fetch_add(&timer->buckets[debug_timer_bucket(ticks)], 1, __ATOMIC_RELAXED);
+	while (ticks > max && !__atomic_compare_exchange_n(&timer->max, &max, ticks, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+/**
+ * @brief ns per tick << 32, measured once against CLOCK_MONOTONIC (10 ms)
+ */
+DEBUG_INTERNAL uint64_t debug_timer_mult(void)
+{
+#if defined(__x86_64__)
+	uint64_t mult = __atomic_load_n(&debug_timers.mult, __ATOMIC_RELAXED);
+	uint64_t ns0;
+	uint64_t tsc0;
+	uint64_t ns;
+	uint64_t tsc;
+
+	if (mult != 0)
+		return mult;
+	if (debug_clock.source == DEBUG_CLOCK_TSC)
+		mult = debug_clock.mult;
+	else
+	{
+		ns0 = debug_clock_read(CLOCK_MONOTONIC);
+		tsc0 = __rdtsc();
+		do
+		{
+			ns = debug_clock_read(CLOCK_MONOTONIC);
+			tsc = __rdtsc();
+		} while (ns - ns0 < 10000000);
+		mult = tsc > tsc0 ? ((ns - ns0) << 32) / (tsc - tsc0) : (uint64_t)1 << 32;
+	}
+	__atomic_store_n(&debug_timers.mult, mult, __ATOMIC_RELAXED);
+	return mult;
+#else
+	return (uint64_t)1 << 32;
+#endif // __x86_64__
+}
+
+DEBUG_INTERNAL uint64_t debug_timer_ns(uint64_t ticks, uint64_t mult)
+{
+	return (uint64_t)(((unsigned __int128)ticks * mult) >> 32);
+}
+
+/**
+ * @brief Count, mean, percentiles and max of a timer, read while it may still record
+ * @details The mean and the percentiles are as precise as the buckets.
+ */
+DEBUG_INTERNAL void debug_timer_summary(const struct debug_timer *timer, struct debug_timer_stats *stats)
+{
+	static const double quantiles[3] = {0.5, 0.99, 0.999};
+	uint64_t *values[3] = {&stats->p50, &stats->p99, &stats->p999};
+	uint64_t counts[DEBUG_TIMER_BUCKETS];
+	const uint64_t mult = debug_timer_mult();
+	const uint64_t max = __atomic_load_n(&timer->max, __ATOMIC_RELAXED);
+	uint64_t seen = 0;
+	unsigned __int128 sum = 0;
+	unsigned q = 0;
+
+	stats->count = 0;
+	for (unsigned i = 0; i < DEBUG_TIMER_BUCKETS; ++i)
+		stats->count += counts[i] = __atomic_load_n(&timer->buckets[i], __ATOMIC_RELAXED);
+	stats->p50 = stats->p99 = stats->p999 = 0;
+	for (unsigned i = 0; i < DEBUG_TIMER_BUCKETS; ++i)
+	{
+		uint64_t upper = debug_timer_upper(i) < max ? debug_timer_upper(i) : max;
+
+		if (counts[i] == 0)
+			continue;
+		seen += counts[i];
+		sum += (unsigned __int128)counts[i] * ((debug_timer_lower(i) + upper) / 2);
+		while (q < 3 && seen >= quantiles[q] * stats->count)
+			*values[q++] = debug_timer_ns(upper, mult);
+	}
+	stats->mean = stats->count != 0 ? debug_timer_ns(sum / stats->count, mult) : 0;
+	stats->max = debug_timer_ns(max, mult);
+}
+
+/**
+ * @brief A duration with its unit: "850 ns", "1.25 us", "3.40 ms", "2.00 s"
+ */
+DEBUG_INTERNAL int debug_timer_duration(char *out, size_t size, uint64_t ns)
+{
+	if (ns < 1000)
+		return snprintf(out, size, "%llu ns", (unsigned long long)ns);
+	if (ns < 1000000)
+		return snprintf(out, size, "%.2f us", ns / 1e3);
+	if (ns < 1000000000)
+		return snprintf(out, size, "%.2f ms", ns / 1e6);
+	return snprintf(out, size, "%.2f s", ns / 1e9);
+}
+
+/**
+ * @brief "timer name: N samples, mean ..., p50 ..., p99 ..., p99.9 ..., max ..."
+ * @return Bytes written, cut at size - 1
+ */
+DEBUG_INTERNAL size_t debug_timer_message(const struct debug_timer *timer, const struct debug_timer_stats *stats, char *out, size_t size)
+{
+	char d[5][16];
+	int n;
+
+	debug_timer_duration(d[0], sizeof(d[0]), stats->mean);
+	debug_timer_duration(d[1], sizeof(d[1]), stats->p50);
+	debug_timer_duration(d[2], sizeof(d[2]), stats->p99);
+	debug_timer_duration(d[3], sizeof(d[3]), stats->p999);
+	debug_timer_duration(d[4], sizeof(d[4]), stats->max);
+	n = snprintf(out, size, "timer %s: %llu samples, mean %s, p50 %s, p99 %s, p99.9 %s, max %s", timer->name, (unsigned long long)stats->count, d[0], d[1], d[2], d[3], d[4]);
+	return n < 0 ? 0 : (size_t)n >= size ? size - 1 : (size_t)n;
+}
+
+/**
+ * @brief Fields of a structured summary: timer, count, then the durations in ns
+ */
+DEBUG_INTERNAL void debug_timer_fields(const struct debug_timer *timer, const struct debug_timer_stats *stats, struct debug_kv *kv)
+{
+	static const char *const keys[DEBUG_TIMER_FIELDS] = {"timer", "count", "mean_ns", "p50_ns", "p99_ns", "p999_ns", "max_ns"};
+	const uint64_t values[DEBUG_TIMER_FIELDS] = {0, stats->count, stats->mean, stats->p50, stats->p99, stats->p999, stats->max};
+
+	for (unsigned i = 0; i < DEBUG_TIMER_FIELDS; ++i)
+	{
+		kv[i].key = keys[i];
+		kv[i].type = i == 0 ? DEBUG_ARG_STRING : DEBUG_ARG_U64;
+		if (i == 0)
+			kv[i].v.s = timer->name;
+		else
+			kv[i].v.u = values[i];
+	}
+}
+
+/**
+ * @brief Print the summary of every timer which recorded something
+ * @details At exit, and on demand. The summaries are records of level
+ * DEBUG_TIMER_LEVEL, filtered by DEBUG as the statements of the function.
+ */
+DEBUG_INTERNAL void debug_timers_report(void)
+{
+	for (struct debug_timer *t = __atomic_load_n(&debug_timers.head, __ATOMIC_ACQUIRE); t != NULL; t = t->next)
+		t->report(t);
+}
+#else
+DEBUG_INTERNAL void debug_timer_record(struct debug_timer *timer, uint64_t ticks);
+DEBUG_INTERNAL void debug_timer_summary(const struct debug_timer *timer, struct debug_timer_stats *stats);
+DEBUG_INTERNAL size_t debug_timer_message(const struct debug_timer *timer, const struct debug_timer_stats *stats, char *out, size_t size);
+DEBUG_INTERNAL void debug_timer_fields(const struct debug_timer *timer, const struct debug_timer_stats *stats, struct debug_kv *kv);
+DEBUG_INTERNAL void debug_timers_report(void);
+#endif // DEBUG_DEFINITIONS
+
+#endif // DEBUG_TIMER_H
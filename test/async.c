@@ -0,0 +1,66 @@
+/*******************************************************************************
+ * @file		async.c
+ * @brief		Asynchronous output past the capacity of the ring: the process
+ *				still exits, whatever the overflow policy
+ * @date		Su Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sun Oct 18 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/debug.h"
+
+#define RECORDS 200000
+
+/**
+ * @brief Drain the output late, so that the ring fills up first
+ */
+static void *reader(void *arg)
+{
+	int fd = *(int *)arg;
+	struct timespec ts = {0, 200000000};
+	char buf[65536];
+
+	nanosleep(&ts, NULL);
+	while (read(fd, buf, sizeof(buf)) > 0)
+		;
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	static const char *const names[] = {"block", "drop-newest", "drop-oldest"};
+	enum debug_overflow policy = DEBUG_OVERFLOW_BLOCK;
+	pthread_t thread;
+	int fds[2];
+	int report = dup(DEBUG_OUT);
+
+	for (int i = 0; argc > 1 && i < 3; ++i)
+		if (strcmp(argv[1], names[i]) == 0)
+			policy = (enum debug_overflow)i;
+	if (pipe(fds) != 0 || dup2(fds[1], DEBUG_OUT) < 0)
+		return 1;
+	pthread_create(&thread, NULL, reader, &fds[0]);
+	pthread_detach(thread);
+
+	debug_async_start(policy);
+	for (int i = 0; i < RECORDS; ++i)
+		printf_info("record %d", i);
+	debug_async_stop();
+
+	dprintf(report, "async %-12s stopped, %lu records dropped\n", names[policy], debug_async.dropped);
+	return 0;
+}
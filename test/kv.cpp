@@ -0,0 +1,68 @@
+/*******************************************************************************
+ * @file		kv.cpp
+ * @brief		Fields of a text record, and the text around them, are parted
+ *				by a space whatever their order
+ * @date		Su Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sun Oct 18 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include "../src/debug.hpp"
+
+int main()
+{
+	static const char *const expected[] = {
+		"k=5 kvmsg",
+		"kvmsg k=5",
+		"before k=5 after",
+		"a=1 b=2 3",
+		"fmt 1 k=2",
+	};
+	char buf[4096];
+	int fds[2];
+	int report = dup(DEBUG_OUT);
+	int failed = 0;
+
+	if (pipe(fds) != 0 || dup2(fds[1], DEBUG_OUT) < 0)
+		return 1;
+
+	debug::log::info().kv("k", 5) << "kvmsg";
+	(debug::log::info() << "kvmsg").kv("k", 5);
+	(debug::log::info() << "before").kv("k", 5) << "after";
+	debug::log::info().kv("a", 1).kv("b", 2) << 3;
+	debug::log::info("fmt {}", 1).kv("k", 2);
+
+	std::fflush(stdout);
+	close(fds[1]);
+	close(DEBUG_OUT);
+	const ssize_t n = read(fds[0], buf, sizeof(buf) - 1);
+	buf[n > 0 ? n : 0] = '\0';
+
+	char *line = buf;
+	for (const char *want : expected)
+	{
+		char *end = std::strchr(line, '\n');
+		const std::size_t len = std::strlen(want);
+
+		if (end == NULL || static_cast<std::size_t>(end - line) < len || std::memcmp(end - len, want, len) != 0)
+		{
+			dprintf(report, "kv: expected \"%s\" at the end of \"%.*s\"\n", want, end != NULL ? static_cast<int>(end - line) : 0, line);
+			failed = 1;
+		}
+		if (end == NULL)
+			break;
+		line = end + 1;
+	}
+	return failed;
+}
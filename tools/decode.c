@@ -0,0 +1,637 @@
+/*******************************************************************************
+ * @file		decode.c
+ * @brief		Render a DEBUG_BINARY stream, or a DEBUG_RECORDER file, as the
+ *				text output would be
+ * @date		Sa Oct 2026
+ * @author		Dimitri Simon
+ *
+ * PROJECT:		DEBUG
+ *
+ * MODIFIED:	Sat Oct 17 2026
+ * BY:			Dimitri Simon
+ *
+ * Copyright (c) 2026 Dimitri Simon
+ *
+ *******************************************************************************/
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/binary.h"
+
+#define DEBUG_SPACING_FUNCTION_CPP_ADD 6 // As debug.hpp
+#define SITES_MAX (1u << 24)			   // Higher site ids mean a corrupted file
+
+#define USAGE "Usage: debug-decode [-t] [-p] file|-\n"              \
+			  "  -t  prefix each record with its wall clock time\n" \
+			  "  -p  plain, without colors (default when not a terminal)\n"
+
+struct site
+{
+	int level;
+	int kind;
+	unsigned line;
+	char *file;
+	char *func;
+	char *format;
+};
+
+/**
+ * @brief Argument of a record
+ */
+struct arg
+{
+	int type;
+	union
+	{
+		int i32;
+		long long i64;
+		unsigned long long u64;
+		double d;
+		long double ld;
+		void *ptr;
+		char c;
+	} v;
+	char str[DEBUG_BINARY_STRING + 1];
+};
+
+struct cursor
+{
+	const unsigned char *p;
+	const unsigned char *end;
+};
+
+static struct site *sites;
+static unsigned nsites;
+
+static int take(struct cursor *c, void *dst, size_t n)
+{
+	if ((size_t)(c->end - c->p) < n)
+		return -1;
+	memcpy(dst, c->p, n);
+	c->p += n;
+	return 0;
+}
+
+static char *take_string(struct cursor *c, size_t n)
+{
+	char *s = malloc(n + 1);
+
+	if (s == NULL || take(c, s, n) != 0)
+	{
+		free(s);
+		return NULL;
+	}
+	s[n] = '\0';
+	return s;
+}
+
+static int take_arg(struct cursor *c, struct arg *arg)
+{
+	unsigned char type;
+	uint16_t len;
+
+	if (take(c, &type, 1) != 0)
+		return -1;
+	arg->type = type;
+	switch (type)
+	{
+	case DEBUG_ARG_I32:
+		return take(c, &arg->v.i32, 4);
+	case DEBUG_ARG_I64:
+		return take(c, &arg->v.i64, 8);
+	case DEBUG_ARG_U64:
+		return take(c, &arg->v.u64, 8);
+	case DEBUG_ARG_DOUBLE:
+		return take(c, &arg->v.d, 8);
+	case DEBUG_ARG_LDOUBLE:
+		return take(c, &arg->v.ld, sizeof(long double));
+	case DEBUG_ARG_POINTER:
+		return take(c, &arg->v.ptr, sizeof(void *));
+	case DEBUG_ARG_CHAR:
+	case DEBUG_ARG_BOOL:
+		return take(c, &arg->v.c, 1);
+	case DEBUG_ARG_STRING:
+		if (take(c, &len, 2) != 0 || len > DEBUG_BINARY_STRING || take(c, arg->str, len) != 0)
+			return -1;
+		arg->str[len] = '\0';
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+static const char *tag(int level)
+{
+	switch (level)
+	{
+	case LOG_UNDEFINED:
+		return DEBUG_TAG_NONE;
+	case LOG_FATAL:
+		return DEBUG_TAG_FATAL;
+	case LOG_ERROR:
+		return DEBUG_TAG_ERROR;
+	case LOG_WARNING:
+		return DEBUG_TAG_WARNING;
+	case LOG_INFO:
+		return DEBUG_TAG_INFO;
+	case LOG_DEBUG:
+		return DEBUG_TAG_DEBUG;
+	default:
+		return DEBUG_TAG_TRACE;
+	}
+}
+
+/**
+ * @brief Format one conversion of a C site with its argument
+ */
+static void render_conversion(FILE *out, const struct debug_conversion *conv, const int *stars, const struct arg *arg)
+{
+	char spec[64];
+
+	if (conv->len >= sizeof(spec))
+		return;
+	memcpy(spec, conv->start, conv->len);
+	spec[conv->len] = '\0';
+	if (conv->type == DEBUG_ARG_NONE)
+	{
+		fprintf(out, strcmp(spec, "%%") == 0 ? "%%" : "%s", spec);
+		return;
+	}
+	if (arg == NULL)
+	{
+		fputs("<missing>", out);
+		return;
+	}
+	if (spec[conv->len - 1] == 'n')
+		return;
+#define CONVERSION(value)                                               \
+	(conv->stars == 2	? fprintf(out, spec, stars[0], stars[1], value) \
+	 : conv->stars == 1 ? fprintf(out, spec, stars[0], value)           \
+						: fprintf(out, spec, value))
+	switch (arg->type)
+	{
+	case DEBUG_ARG_I32:
+		CONVERSION(arg->v.i32);
+		break;
+	case DEBUG_ARG_I64:
+		CONVERSION(arg->v.i64);
+		break;
+	case DEBUG_ARG_DOUBLE:
+		CONVERSION(arg->v.d);
+		break;
+	case DEBUG_ARG_LDOUBLE:
+		CONVERSION(arg->v.ld);
+		break;
+	case DEBUG_ARG_STRING:
+		CONVERSION(arg->str);
+		break;
+	default:
+		// %p, or a wide string which was not kept
+		fprintf(out, "%p", arg->v.ptr);
+		break;
+	}
+#undef CONVERSION
+}
+
+/**
+ * @brief Message of a C site, its format applied to the arguments
+ * @details An argument of another type than its conversion is shown as
+ * <mismatch>, from a corrupted file.
+ */
+static int render_c(FILE *out, const struct site *site, struct cursor *args)
+{
+	const char *format = site->format;
+	const char *next;
+	struct debug_conversion conv;
+	struct arg arg;
+	int stars[2];
+
+	while ((next = debug_conversion(format, &conv)) != NULL)
+	{
+		int mismatch = 0;
+
+		fwrite(format, 1, conv.start - format, out);
+		for (int i = 0; i < conv.stars; ++i)
+		{
+			if (take_arg(args, &arg) != 0)
+				return -1;
+			mismatch |= arg.type != DEBUG_ARG_I32;
+			stars[i] = arg.v.i32;
+		}
+		if (conv.type == DEBUG_ARG_NONE)
+			render_conversion(out, &conv, stars, NULL);
+		else if (args->p == args->end)
+			render_conversion(out, &conv, stars, NULL);
+		else if (take_arg(args, &arg) != 0)
+			return -1;
+		else if (mismatch || arg.type != conv.type)
+			fputs("<mismatch>", out);
+		else
+			render_conversion(out, &conv, stars, &arg);
+		format = next;
+	}
+	fputs(format, out);
+	return 0;
+}
+
+/**
+ * @brief Message of a C++ site, the operands of << one after the other
+ */
+static int render_cpp(FILE *out, struct cursor *args)
+{
+	struct arg arg;
+
+	while (args->p < args->end)
+	{
+		if (take_arg(args, &arg) != 0)
+			return -1;
+		switch (arg.type)
+		{
+		case DEBUG_ARG_I32:
+			fprintf(out, "%d", arg.v.i32);
+			break;
+		case DEBUG_ARG_I64:
+			fprintf(out, "%lld", arg.v.i64);
+			break;
+		case DEBUG_ARG_U64:
+			fprintf(out, "%llu", arg.v.u64);
+			break;
+		case DEBUG_ARG_DOUBLE:
+			fprintf(out, "%g", arg.v.d);
+			break;
+		case DEBUG_ARG_LDOUBLE:
+			fprintf(out, "%Lg", arg.v.ld);
+			break;
+		case DEBUG_ARG_STRING:
+			fputs(arg.str, out);
+			break;
+		case DEBUG_ARG_POINTER:
+			fprintf(out, "%p", arg.v.ptr);
+			break;
+		case DEBUG_ARG_CHAR:
+			fputc(arg.v.c, out);
+			break;
+		case DEBUG_ARG_BOOL:
+			fputc(arg.v.c ? '1' : '0', out);
+			break;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Drop the escape sequences of a line
+ */
+static void strip(char *line)
+{
+	char *dst = line;
+
+	for (char *src = line; *src != '\0'; ++src)
+	{
+		if (*src == '\033' && src[1] == '[')
+		{
+			src += 2;
+			while (*src != '\0' && *src != 'm')
+				++src;
+			if (*src == '\0')
+				break;
+			continue;
+		}
+		*dst++ = *src;
+	}
+	*dst = '\0';
+}
+
+static void render_time(FILE *out, int64_t offset, uint64_t now)
+{
+	int64_t ns = (int64_t)now + offset;
+	time_t sec = ns / 1000000000;
+	struct tm tm;
+	char date[32];
+
+	localtime_r(&sec, &tm);
+	strftime(date, sizeof(date), "%F %T", &tm);
+	fprintf(out, "%s.%09lld ", date, (long long)(ns % 1000000000));
+}
+
+static int define(struct cursor *c)
+{
+	uint32_t id;
+	int8_t level;
+	uint8_t kind;
+	uint32_t line;
+	uint16_t lens[3];
+	struct site site;
+
+	if (take(c, &id, 4) != 0 || take(c, &level, 1) != 0 || take(c, &kind, 1) != 0 || take(c, &line, 4) != 0 || take(c, lens, sizeof(lens)) != 0)
+		return -1;
+	site = (struct site){level, kind, line, take_string(c, lens[0]), take_string(c, lens[1]), take_string(c, lens[2])};
+	if (site.file == NULL || site.func == NULL || site.format == NULL || id >= SITES_MAX)
+		return -1;
+	if (id >= nsites)
+	{
+		size_t n = (size_t)id * 2 + 16;
+		struct site *grown = realloc(sites, n * sizeof(*sites));
+
+		if (grown == NULL)
+			return -1;
+		memset(grown + nsites, 0, (n - nsites) * sizeof(*sites));
+		sites = grown;
+		nsites = n;
+	}
+	sites[id] = site;
+	return 0;
+}
+
+/**
+ * @brief Render a record
+ * @param tid Thread of a flight recorder, 0 for none
+ * @param line Scratch stream over text, the record is written at once
+ */
+static int record(struct cursor *c, int64_t offset, int timestamps, int plain, unsigned tid, FILE *line, char **text)
+{
+	uint32_t id;
+	uint64_t now;
+	uint32_t size;
+	struct cursor args;
+	const struct site *site;
+	int ret;
+
+	if (take(c, &id, 4) != 0 || take(c, &now, 8) != 0 || take(c, &size, 4) != 0 || (size_t)(c->end - c->p) < size)
+		return -1;
+	args = (struct cursor){c->p, c->p + size};
+	c->p += size;
+	if (id >= nsites || sites[id].file == NULL)
+		return -1;
+	site = &sites[id];
+
+	rewind(line);
+	if (timestamps)
+		render_time(line, offset, now);
+	if (tid != 0)
+		fprintf(line, "[%u] ", tid);
+	fputs(tag(site->level), line);
+	if (site->kind == DEBUG_KIND_C)
+	{
+		fprintf(line, T_OUT(T_FG_YELLOW) "%-*s" T_RESET " " T_OUT(T_BOLD T_FG_WHITE) "%-*s" T_OUT("0;" T_FG_CYAN) "%*u" T_RESET " ",
+				DEBUG_SPACING_FILE, site->file, DEBUG_SPACING_FUNCTION, site->func, DEBUG_SPACING_LINE, site->line);
+		ret = render_c(line, site, &args);
+	}
+	else
+	{
+		fprintf(line, T_OUT(T_FG_YELLOW) "%-*s" T_RESET " " T_OUT(T_BOLD T_FG_WHITE) "%-*s" T_RESET " " T_OUT(T_FG_CYAN) "%*u" T_RESET " ",
+				DEBUG_SPACING_FILE, site->file, DEBUG_SPACING_FUNCTION + DEBUG_SPACING_FUNCTION_CPP_ADD, site->func, DEBUG_SPACING_LINE, site->line);
+		ret = render_cpp(line, &args);
+	}
+	fputc('\0', line);
+	fflush(line);
+	if (plain)
+		strip(*text);
+	fputs(*text, stdout);
+	fputc('\n', stdout);
+	return ret;
+}
+
+/**
+ * @brief Entry of a ring of a flight recorder
+ */
+struct entry
+{
+	uint64_t now;
+	unsigned tid;
+	const unsigned char *p; // 'R' or 'C'
+	size_t size;
+};
+
+static int entry_compare(const void *a, const void *b)
+{
+	const struct entry *x = a;
+	const struct entry *y = b;
+
+	return x->now < y->now ? -1 : x->now > y->now;
+}
+
+/**
+ * @brief Add the entries of a ring, oldest first, stopping at the first inconsistent one
+ */
+static int ring_entries(const struct debug_recorder_ring *ring, struct entry **entries, size_t *count, size_t *cap)
+{
+	const unsigned char *data = (const unsigned char *)(ring + 1);
+	uint64_t pos = ring->tail;
+
+	if (ring->head < ring->tail || ring->head - ring->tail > ring->size)
+		return -1;
+	while (pos < ring->head)
+	{
+		uint64_t off = pos % ring->size;
+		struct entry e = {0, ring->tid, data + off, 0};
+		uint32_t size;
+
+		if (data[off] == 'P')
+		{
+			pos += ring->size - off;
+			continue;
+		}
+		if (data[off] == 'R' && off + DEBUG_BINARY_HEADER <= ring->size)
+		{
+			memcpy(&e.now, data + off + 5, 8);
+			memcpy(&size, data + off + 13, 4);
+			e.size = DEBUG_BINARY_HEADER + (size_t)size;
+		}
+		else if (data[off] == 'C' && off + DEBUG_RECORDER_CRASH <= ring->size)
+		{
+			memcpy(&e.now, data + off + 5, 8);
+			e.size = DEBUG_RECORDER_CRASH;
+		}
+		if (e.size == 0 || off + e.size > ring->size)
+			return -1;
+		if (*count == *cap)
+		{
+			struct entry *grown = realloc(*entries, (*cap = *cap * 2 + 1024) * sizeof(**entries));
+
+			if (grown == NULL)
+				return -1;
+			*entries = grown;
+		}
+		(*entries)[(*count)++] = e;
+		pos += e.size;
+	}
+	return 0;
+}
+
+/**
+ * @brief Records of every thread of a flight recorder, in time order
+ */
+static int recorder(const char *path, const unsigned char *data, size_t size, int timestamps, int plain, FILE *line, char **text)
+{
+	struct debug_recorder_header header;
+	struct cursor c;
+	struct entry *entries = NULL;
+	size_t count = 0;
+	size_t cap = 0;
+	int ret = 0;
+	int marked = 0; // A thread had a crash marker
+
+	memcpy(&header, data, sizeof(header));
+	if (size < DEBUG_RECORDER_HEADER + (size_t)header.sites_size + (size_t)header.rings * header.ring_size || header.sites_len > header.sites_size)
+	{
+		fprintf(stderr, "%s: truncated flight recorder\n", path);
+		return 1;
+	}
+	c = (struct cursor){data + DEBUG_RECORDER_HEADER, data + DEBUG_RECORDER_HEADER + header.sites_len};
+	while (c.p < c.end)
+	{
+		if (*c.p++ != 'S' || define(&c) != 0)
+		{
+			fprintf(stderr, "%s: corrupted site at offset %zu\n", path, (size_t)(c.p - data));
+			return 1;
+		}
+	}
+	for (uint32_t i = 0; i < header.rings && i < header.rings_used; ++i)
+	{
+		const struct debug_recorder_ring *ring = (const struct debug_recorder_ring *)(data + DEBUG_RECORDER_HEADER + header.sites_size + (size_t)i * header.ring_size);
+
+		if (ring_entries(ring, &entries, &count, &cap) != 0)
+			fprintf(stderr, "%s: ring of thread %u corrupted, the rest of it is skipped\n", path, ring->tid);
+	}
+	qsort(entries, count, sizeof(*entries), entry_compare);
+	for (size_t i = 0; i < count; ++i)
+	{
+		int32_t sig;
+
+		if (*entries[i].p == 'C')
+		{
+			marked = 1;
+			memcpy(&sig, entries[i].p + 1, 4);
+			if (timestamps)
+				render_time(stdout, header.offset, entries[i].now);
+			printf("[%u] --- crashed: signal %d (%s) ---\n", entries[i].tid, sig, strsignal(sig));
+			continue;
+		}
+		c = (struct cursor){entries[i].p + 1, entries[i].p + entries[i].size};
+		if (record(&c, header.offset, timestamps, plain, entries[i].tid, line, text) != 0)
+			ret = 1;
+	}
+	if (header.crash_signal == 0)
+		printf("--- no crash recorded ---\n");
+	else if (!marked) // In a thread without a ring
+	{
+		if (timestamps)
+			render_time(stdout, header.offset, header.crash_time);
+		printf("--- crashed: signal %d (%s) ---\n", header.crash_signal, strsignal(header.crash_signal));
+	}
+	free(entries);
+	return ret;
+}
+
+static unsigned char *slurp(const char *path, size_t *size)
+{
+	FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+	unsigned char *data = NULL;
+	size_t cap = 0;
+	size_t n;
+
+	*size = 0;
+	if (in == NULL)
+		return NULL;
+	do
+	{
+		if (*size == cap)
+		{
+			unsigned char *grown = realloc(data, cap = cap * 2 + 65536);
+
+			if (grown == NULL)
+			{
+				free(data);
+				data = NULL;
+				break;
+			}
+			data = grown;
+		}
+		n = fread(data + *size, 1, cap - *size, in);
+		*size += n;
+	} while (n > 0);
+	if (in != stdin)
+		fclose(in);
+	return data;
+}
+
+int main(int argc, char **argv)
+{
+	int timestamps = 0;
+	int plain = !isatty(STDOUT_FILENO);
+	int opt;
+	size_t size;
+	unsigned char *data;
+	struct cursor c;
+	int64_t offset;
+	char *text = NULL;
+	size_t len = 0;
+	FILE *line;
+
+	while ((opt = getopt(argc, argv, "tp")) != -1)
+	{
+		if (opt == 't')
+			timestamps = 1;
+		else if (opt == 'p')
+			plain = 1;
+		else
+		{
+			fputs(USAGE, stderr);
+			return 2;
+		}
+	}
+	if (optind + 1 != argc)
+	{
+		fputs(USAGE, stderr);
+		return 2;
+	}
+	data = slurp(argv[optind], &size);
+	if (data == NULL)
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+	line = open_memstream(&text, &len);
+	if (line == NULL)
+		return 1;
+	if (size >= DEBUG_RECORDER_HEADER && memcmp(data, DEBUG_RECORDER_MAGIC, sizeof(DEBUG_RECORDER_MAGIC) - 1) == 0)
+	{
+		int ret = recorder(argv[optind], data, size, timestamps, plain, line, &text);
+
+		fclose(line);
+		free(text);
+		free(data);
+		return ret;
+	}
+	c = (struct cursor){data, data + size};
+	if (size < sizeof(DEBUG_BINARY_MAGIC) - 1 + 8 || memcmp(data, DEBUG_BINARY_MAGIC, sizeof(DEBUG_BINARY_MAGIC) - 1) != 0)
+	{
+		fprintf(stderr, "%s: neither a DEBUG_BINARY stream nor a DEBUG_RECORDER file\n", argv[optind]);
+		return 1;
+	}
+	c.p += sizeof(DEBUG_BINARY_MAGIC) - 1;
+	take(&c, &offset, 8);
+
+	while (c.p < c.end)
+	{
+		char kind = *c.p++;
+		int ret = kind == 'S' ? define(&c) : kind == 'R' ? record(&c, offset, timestamps, plain, 0, line, &text)
+														 : -1;
+
+		if (ret != 0)
+		{
+			fprintf(stderr, "%s: corrupted at offset %zu\n", argv[optind], (size_t)(c.p - data));
+			return 1;
+		}
+	}
+	fclose(line);
+	free(text);
+	free(data);
+	return 0;
+}